@@ -0,0 +1,194 @@
+#include "mdlr/engine.h"
+#include "mdlr/modules/core.h"
+#include "mdlr/modules/enveloppe.h"
+
+#include <fmt/format.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+
+using namespace mdlr;
+
+// Synthetic patches driven through Engine::callback on the offline driver.
+// Usage: mdlr_bench [blocks=2000] [buffersize=128] [samplerate=48000] [threads=1]
+
+static int countModules(const Group& group)
+{
+    int count = 0;
+    for (const auto& m: group.modules)
+    {
+        count++;
+        if (auto g = dynamic_cast<const Group*>(m.get()))
+            count += countModules(*g);
+    }
+    return count;
+}
+
+// Oscillator -> EnveloppeADSR -> Attenuator, gated by a slow square
+static Slot& chain(Group& group, int index)
+{
+    auto& osc = group.create<Oscillator>(fmt::format("osc{}", index));
+    auto& lfo = group.create<Oscillator>(fmt::format("lfo{}", index));
+    auto& env = group.create<EnveloppeADSR>(fmt::format("env{}", index));
+    auto& vca = group.create<Attenuator>(fmt::format("vca{}", index));
+    osc.ins[Oscillator::slot_frequency] = 110.f + index;
+    lfo.ins[Oscillator::slot_frequency] = 2.f + 0.1f * index;
+    env.ins[EnveloppeADSR::slot_a] = 0.01f;
+    env.ins[EnveloppeADSR::slot_d] = 0.1f;
+    env.ins[EnveloppeADSR::slot_s] = 0.5f;
+    env.ins[EnveloppeADSR::slot_r] = 0.2f;
+    lfo.outs[Oscillator::slot_output].connect(env.ins[EnveloppeADSR::slot_gate]);
+    osc.outs[Oscillator::slot_output].connect(vca.ins[Attenuator::slot_input]);
+    env.outs[EnveloppeADSR::slot_output].connect(vca.ins[Attenuator::slot_gain]);
+    return vca.outs[Attenuator::slot_output];
+}
+
+// Sums the slots through a tree of Mixer8
+static Slot& mixdown(Group& group, std::vector<Slot*> slots)
+{
+    int index = 0;
+    while (slots.size() > 1)
+    {
+        std::vector<Slot*> next;
+        for (size_t i = 0; i < slots.size(); i += 8)
+        {
+            auto& mixer = group.create<Mixer8>(fmt::format("mix{}", index++));
+            for (size_t j = i; j < std::min(i + 8, slots.size()); j++)
+            {
+                slots[j]->connect(mixer.ins[Mixer8::slot_in0 + (j - i)]);
+                mixer.ins[Mixer8::slot_volume0 + (j - i)] = 0.125f;
+            }
+            next.push_back(&mixer.outs[Mixer8::slot_output]);
+        }
+        slots = std::move(next);
+    }
+    return *slots.front();
+}
+
+static void chains(Group& system, int count)
+{
+    for (int i = 0; i < count; i++)
+        chain(system, i).connect(system.outs[i % system.outs.size()]);
+}
+
+static void fanin(Group& system, int count)
+{
+    std::vector<Slot*> slots;
+    for (int i = 0; i < count; i++)
+    {
+        auto& osc = system.create<Oscillator>(fmt::format("osc{}", i));
+        osc.ins[Oscillator::slot_frequency] = 50.f + i;
+        slots.push_back(&osc.outs[Oscillator::slot_output]);
+    }
+    mixdown(system, slots).connect(system.outs[0]);
+}
+
+// Each level holds a chain and the next level, mixed into its single output
+static void nested(Group& system, int depth)
+{
+    Group* group = &system;
+    Slot* output = &system.outs[0];
+    for (int d = 0; d < depth; d++)
+    {
+        auto& inner = group->create<Group>(fmt::format("level{}", d));
+        auto& out = inner.addOutput("output");
+        chain(inner, d).connect(out);
+        auto& vca = group->create<Attenuator>(fmt::format("vca{}", d));
+        out.connect(vca.ins[Attenuator::slot_input]);
+        vca.outs[Attenuator::slot_output].connect(*output);
+        group = &inner;
+        output = &out;
+    }
+}
+
+struct Result
+{
+    double nspersample;
+    double nspermodule;
+    double load;
+    double p50, p99, p999, max;
+};
+
+static Result run(std::function<void(Group&)> build, int blocks, int buffersize, int samplerate, int threads)
+{
+    std::vector<float> unused;
+    Engine engine;
+    engine.init({
+        .capture = { .channels = 0 },
+        .playback = { .channels = 2 },
+        .samplerate = samplerate,
+        .buffersize = buffersize,
+        .backend = DriverBackend::Offline,
+        .offline = { .buffer = &unused },
+    }, threads);
+    build(engine.system);
+    engine.start();
+
+    const int modules = std::max(1, countModules(engine.system));
+    std::vector<float> outs(size_t(buffersize) * engine.driver->playback.channels);
+    std::vector<double> times(blocks);
+
+    for (int b = 0; b < blocks / 10 + 1; b++)
+        engine.callback(nullptr, outs.data(), buffersize);
+
+    for (int b = 0; b < blocks; b++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        engine.callback(nullptr, outs.data(), buffersize);
+        auto end = std::chrono::steady_clock::now();
+        times[b] = std::chrono::duration<double, std::nano>(end - start).count();
+    }
+
+    double total = 0.;
+    for (auto t: times)
+        total += t;
+    std::sort(times.begin(), times.end());
+    auto percentile = [&](double p) { return times[std::min(size_t(p * blocks), times.size() - 1)]; };
+
+    const double budget = 1e9 * buffersize / samplerate;
+    const double mean = total / blocks;
+    return {
+        .nspersample = mean / buffersize,
+        .nspermodule = mean / buffersize / modules,
+        .load = mean / budget,
+        .p50 = percentile(0.5) / budget,
+        .p99 = percentile(0.99) / budget,
+        .p999 = percentile(0.999) / budget,
+        .max = times.back() / budget,
+    };
+}
+
+int main(int argc, char** argv)
+{
+    const int blocks = argc > 1 ? std::atoi(argv[1]) : 2000;
+    const int buffersize = argc > 2 ? std::atoi(argv[2]) : 128;
+    const int samplerate = argc > 3 ? std::atoi(argv[3]) : 48000;
+    const int threads = argc > 4 ? std::atoi(argv[4]) : 1;
+
+    struct Case
+    {
+        std::string name;
+        std::function<void(Group&)> build;
+    };
+    std::vector<Case> cases;
+    for (int n: { 1, 16, 64, 256 })
+        cases.push_back({ fmt::format("chains/{}", n), [n](Group& g) { chains(g, n); } });
+    for (int n: { 8, 64, 512 })
+        cases.push_back({ fmt::format("fanin/{}", n), [n](Group& g) { fanin(g, n); } });
+    for (int n: { 4, 16, 64 })
+        cases.push_back({ fmt::format("nested/{}", n), [n](Group& g) { nested(g, n); } });
+
+    fmt::println("{} blocks of {} frames at {}Hz on {} thread(s), load and callback times in % of the {:.0f}us budget"
+        , blocks, buffersize, samplerate, threads, 1e6 * buffersize / samplerate);
+    fmt::println("{:<12} {:>10} {:>10} {:>8} {:>8} {:>8} {:>8} {:>8}"
+        , "case", "ns/sample", "ns/module", "load", "p50", "p99", "p99.9", "max");
+    for (const auto& c: cases)
+    {
+        auto r = run(c.build, blocks, buffersize, samplerate, threads);
+        fmt::println("{:<12} {:>10.1f} {:>10.2f} {:>7.2f}% {:>7.2f}% {:>7.2f}% {:>7.2f}% {:>7.2f}%"
+            , c.name, r.nspersample, r.nspermodule
+            , 100. * r.load, 100. * r.p50, 100. * r.p99, 100. * r.p999, 100. * r.max);
+    }
+    return 0;
+}
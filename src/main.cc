@@ -1,10 +1,13 @@
 #include "mdlr/engine.h"
+#include "mdlr/patch.h"
 #include "mdlr/modules/core.h"
 #include "mdlr/modules/enveloppe.h"
 #include "mdlr/modules/midi.h"
 #include "mdlr/modules/sequencer.h"
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <fmt/format.h>
 
 namespace mdlr
@@ -12,7 +15,9 @@ namespace mdlr
     struct DeeFam: Module
     {
         enum {
-            slot_clock
+            slot_clock,
+            slot_reset,
+            slot_randomize
         };
         enum {
             slot_output
@@ -33,13 +38,14 @@ namespace mdlr
         DeeFam()
         {
             ins = {
-                { "clock" }
+                { "clock" },
+                { "reset" },
+                { "randomize" }
             };
             outs = {
                 { "output" }
             };
 
-            ins[slot_clock].connect(sequencer.ins[Sequencer::slot_clock]);
             sequencer.randomize();
 
             enveloppe.ins[EnveloppeADSR::slot_a] = 0.f;
@@ -55,7 +61,9 @@ namespace mdlr
 
         virtual void process(float samplerate) override
         {
-            ins[slot_clock].propagate();
+            sequencer.ins[Sequencer::slot_clock] = ins[slot_clock].signal;
+            sequencer.ins[Sequencer::slot_reset] = ins[slot_reset].signal;
+            sequencer.ins[Sequencer::slot_randomize] = ins[slot_randomize].signal;
             float trig = clocktrig.process(ins[slot_clock]) ? 1.f : 0.f;
 
             enveloppe_amp.ins[EnveloppeADSR::slot_gate] = trig;
@@ -95,7 +103,7 @@ namespace mdlr
 {
     struct Delay: Module
     {
-        std::vector<float> buffer;
+        Memory buffer;
         int buffersize = 1024*128;
         int readpos = 0;
         int writepos = 0;
@@ -105,30 +113,55 @@ namespace mdlr
             Slot* time;
             Slot* output;
         } slots;
+        Parameter* buffersizeparam;
         float time = 0.f;
         float value = 0.f;
 
         Delay()
         {
-            buffer.resize(buffersize, 0.f);
+            buffer = allocate(buffersize);
             slots.input = &addInput("input");
             slots.time = &addInput("time");
             slots.output = &addOutput("output");
-            addParameter("buffersize", &Delay::buffersize);
+            buffersizeparam = &addParameter("buffersize", buffersize).staging();
         }
 
-        virtual void process(float samplerate) override
+        static Memory allocate(int size)
+        {
+            Memory memory = Memory::allocate(size * sizeof(float));
+            memset(memory.data, 0, memory.size);
+            return memory;
+        }
+
+        virtual void prepareParameter(Parameter& parameter, const ParameterValue& value, Memory& payload) override
         {
-            if (buffersize != buffer.size())
-                buffer.resize(buffersize);
+            if (&parameter == buffersizeparam && std::holds_alternative<int>(value))
+                payload = allocate(std::max(std::get<int>(value), 1));
+        }
+
+        virtual void applyParameter(Parameter& parameter, ParameterValue&& value, Memory& payload) override
+        {
+            if (&parameter != buffersizeparam)
+                return Module::applyParameter(parameter, std::move(value), payload);
+
+            if (!payload.data)
+                return;
+            buffer = std::move(payload);
+            buffersize = buffer.size / sizeof(float);
+            readpos = 0;
+            parameter.set(buffersize);
+        }
 
+        virtual void process(float samplerate) override
+        {
+            float* samples = (float*) buffer.data;
             float time_current = (*slots.time) * buffersize;
             time = time * 0.99 + time_current * 0.01;
 
-            buffer[readpos] = *slots.input;
-            readpos = (readpos + 1) % buffer.size();
-            writepos = (readpos - int(time)) % buffer.size();
-            value = value * 0.9 + buffer[writepos] * 0.1;
+            samples[readpos] = *slots.input;
+            readpos = (readpos + 1) % buffersize;
+            writepos = (readpos - std::clamp(int(time), 0, buffersize) + buffersize) % buffersize;
+            value = value * 0.9 + samples[writepos] * 0.1;
             *slots.output = clamp(value, -1., 1);
         }
     };
@@ -202,6 +235,13 @@ namespace mdlr
     };
 }
 
+namespace mdlr
+{
+    MDLR_REGISTER_MODULE(DeeFam);
+    MDLR_REGISTER_MODULE(Delay);
+    MDLR_REGISTER_MODULE(KellettFilter);
+}
+
 mdlr::Group& acidSynth(mdlr::Group& parent, std::string_view name = "acid")
 {
     using namespace mdlr;
@@ -240,7 +280,7 @@ int main(int argc, char** argv)
     using namespace mdlr;
 
     Engine engine;
-    engine.init({ .samplerate = 48000, .buffersize = 128, .capture = { .selector = { .any = true } } });
+    engine.init({ .samplerate = 48000, .buffersize = 128, .capture = { .selector = { .name = "MOTU", .any = true } }, .playback = { .selector = { .name = "MOTU", .any = true } } }, 4);
     
     // Create modules
     auto& system = engine.system;
@@ -255,8 +295,8 @@ int main(int argc, char** argv)
     // DeeFam voice
     auto& dfa = system.create<DeeFam>("dfa");
     midiclkdiv.outs[ClockDivider::slot_1_6].connect(dfa.ins[DeeFam::slot_clock]);
-    midi.outs[MidiIn::slot_start].connect(dfa.sequencer.ins[Sequencer::slot_reset]);
-    midigate.outs[44].connect(dfa.sequencer.ins[Sequencer::slot_randomize]);
+    midi.outs[MidiIn::slot_start].connect(dfa.ins[DeeFam::slot_reset]);
+    midigate.outs[44].connect(dfa.ins[DeeFam::slot_randomize]);
     // clk.outs[Oscillator::slot_output].connect(dfa.ins[DeeFam::slot_clock]);
     dfa.sequencer.randomize();
     dfa.osc_eg_amount = 400.f;
@@ -293,15 +333,169 @@ int main(int argc, char** argv)
     system.ins[2].connect(*fx1.findInput("input"));
     fx1.findOutput("output")->connect(system.outs[2]);
 
+    // Automation lanes created by "ramp", by target path
+    std::unordered_map<std::string, Lane*> lanes;
+
+    // Modules removed by an edit the engine could not take yet (full command queue). They
+    // are still played and go out with the next commit.
+    std::vector<std::unique_ptr<Module>> unpublished;
+
     engine.start();
     while (true)
     {
         std::cout << "> ";
         std::string str;
         std::getline(std::cin, str);
+        engine.update();
         try {
             if (str == "quit") break;
 
+            // Toggle a log category: "log midi off"
+            if (str.starts_with("log "))
+            {
+                auto args = std::string_view(str).substr(4);
+                auto spacepos = args.find(" ");
+                LogCategory category;
+                if (parse(args.substr(0, spacepos), category))
+                {
+                    bool on = spacepos == std::string_view::npos || args.substr(spacepos + 1) != "off";
+                    Log::instance().enable(category, on);
+                    fmt::println("@ Log {} {}", name(category), on ? "on" : "off");
+                }
+                continue;
+            }
+
+            // Callback deadlines: "stats", "stats reset"
+            if (str == "stats")
+            {
+                fmt::print("{}", engine.statsString());
+                continue;
+            }
+            if (str == "stats reset")
+            {
+                engine.stats.reset();
+                continue;
+            }
+
+            // Replace the whole system with a patch file: "load <file>". The new set is built
+            // while the current one keeps playing, then crossfaded in over 50ms.
+            if (str.starts_with("load "))
+            {
+                auto path = str.substr(5);
+                Patch patch;
+                if (!Patch::load(path, patch))
+                {
+                    fmt::println("@ Cannot read patch {}", path);
+                    continue;
+                }
+                std::erase_if(lanes, [&](const auto& entry) { return engine.detach(*entry.second); });
+                if (!lanes.empty())
+                {
+                    fmt::println("@ Cannot load {}, the engine is busy", path);
+                    continue;
+                }
+                auto removed = system.clear();
+                std::move(removed.begin(), removed.end(), std::back_inserter(unpublished));
+                bool built = build(patch, system);
+                if (!engine.commit(std::move(unpublished), engine.driver->samplerate / 20))
+                {
+                    fmt::println("@ Patch {} built but not playing yet, the engine is busy", path);
+                    continue;
+                }
+                unpublished.clear();
+                fmt::println("@ Patch {} {}", path, built ? "loaded" : "partially loaded");
+                continue;
+            }
+
+            // Write the current system out: "save <file>", "save <file> binary"
+            if (str.starts_with("save "))
+            {
+                auto args = std::string_view(str).substr(5);
+                auto spacepos = args.find(" ");
+                auto path = args.substr(0, spacepos);
+                Patch patch;
+                if (capture(system, patch) && patch.save(path, args.substr(std::min(spacepos, args.size())) == " binary"))
+                    fmt::println("@ Patch written to {}", path);
+                else
+                    fmt::println("@ Cannot write patch {}", path);
+                continue;
+            }
+
+            // Glide an input or a number parameter: "ramp <path> <value> <ms>"
+            if (str.starts_with("ramp "))
+            {
+                auto args = std::string_view(str).substr(5);
+                auto first = args.find(" ");
+                auto second = args.find(" ", first + 1);
+                if (second == std::string_view::npos)
+                {
+                    fmt::println("@ Usage: ramp <path> <value> <ms>");
+                    continue;
+                }
+                auto path = std::string(args.substr(0, first));
+                const float value = std::strtof(args.data() + first + 1, nullptr);
+                const float ms = std::strtof(args.data() + second + 1, nullptr);
+
+                auto& lane = lanes[path];
+                if (!lane)
+                {
+                    if (auto input = system.findInput(path))
+                    {
+                        // Unplugged again when the wire can't be published, the lane stays unused
+                        lane = &engine.automation.attach(*input);
+                        if (!engine.commit(std::move(unpublished)))
+                        {
+                            lane->output.disconnect(*input);
+                            lanes.erase(path);
+                            fmt::println("@ Cannot automate {}, the engine is busy", path);
+                            continue;
+                        }
+                        unpublished.clear();
+                    }
+                    else if (auto param = system.findParameter(path))
+                        lane = engine.automation.attach(*param);
+                }
+                if (!lane || (!lane->parameter && lane->output.consumers == 0))
+                {
+                    lanes.erase(path);
+                    fmt::println("@ Cannot automate {}", path);
+                    continue;
+                }
+                if (!engine.ramp(*lane, value, uint32_t(ms * 0.001f * engine.driver->samplerate)))
+                {
+                    fmt::println("@ Cannot ramp {}, the engine is busy", path);
+                    continue;
+                }
+                fmt::println("@ Ramping {} to {:.2f} over {:.0f}ms", path, value, ms);
+                continue;
+            }
+
+            // Registered module types
+            if (str == "types")
+            {
+                for (auto type: Registry::instance().types())
+                    fmt::println("{}", type);
+                continue;
+            }
+
+            // Per-module load:"profile", "profile reset", "profile dump <file>"
+            if (str.starts_with("profile"))
+            {
+                const float samplerate = engine.driver->samplerate;
+                const int blocksize = engine.system.blocksize;
+                if (str == "profile reset")
+                    profileReset(system);
+                else if (str.starts_with("profile dump "))
+                {
+                    auto path = str.substr(13);
+                    if (profileDump(system, samplerate, blocksize, path))
+                        fmt::println("@ Profile written to {}", path);
+                }
+                else
+                    fmt::print("{}", profileTable(system, samplerate, blocksize));
+                continue;
+            }
+
             auto parenpos = str.find("()");
             if (parenpos != std::string::npos)
             {
@@ -315,7 +509,7 @@ int main(int argc, char** argv)
                     if (func == "randomize" && mod)
                     {
                         fmt::println("@ Calling {}() on module {}", func, path);
-                        mod->randomize();
+                        engine.call(*mod, [](Module* m, Command& c) { m->randomize(c.argument); });
                     }
                 }
             }
@@ -330,45 +524,38 @@ int main(int argc, char** argv)
                 auto input = system.findInput(path);
                 if (input)
                 {
-                    input->signal = std::strtof(value.data(), nullptr);
-                    fmt::println("@ Setting signal {} to {:.2f}", path, input->signal);
+                    float v = std::strtof(value.data(), nullptr);
+                    engine.setSignal(*input, v);
+                    fmt::println("@ Setting signal {} to {:.2f}", path, v);
                 }
 
+                // Parse the value as the type the parameter currently holds, so that
+                // the audio thread never sees a mismatching variant
                 auto param = system.findParameter(path);
                 if (param)
                 {
-                    bool vset = false;
-                    if (!vset)
+                    ParameterValue current = *param;
+                    if (std::holds_alternative<float>(current))
                     {
-                        try {
-                            float v = std::strtof(value.data(), nullptr);
-                            (*param) = v;
-                            fmt::println("@ Setting parameter {} to {:.2f}", path, v);
-                            vset = true;
-                        } catch (...) {}
+                        float v = std::strtof(value.data(), nullptr);
+                        engine.setParameter(*param, v);
+                        fmt::println("@ Setting parameter {} to {:.2f}", path, v);
                     }
-
-                    if (!vset)
+                    else if (std::holds_alternative<int>(current))
                     {
-                        try {
-                            int v = std::strtol(value.data(), nullptr, 10);
-                            (*param) = v;
-                            fmt::println("@ Setting parameter {} to {}", path, v);
-                            vset = true;
-                        } catch (...) {}
+                        int v = std::strtol(value.data(), nullptr, 10);
+                        engine.setParameter(*param, v);
+                        fmt::println("@ Setting parameter {} to {}", path, v);
                     }
-                    
-                    if (!vset)
+                    else if (std::holds_alternative<bool>(current))
                     {
-                        vset = true;
-                        if (value == "true") { (*param) = true; fmt::println("@ Setting parameter {} to true", path); }
-                        else if (value == "false") { (*param) = false; fmt::println("@ Setting parameter {} to false", path); }
-                        else { vset = false; }
+                        bool v = value == "true";
+                        engine.setParameter(*param, v);
+                        fmt::println("@ Setting parameter {} to {}", path, v);
                     }
-
-                    if (!vset)
+                    else if (std::holds_alternative<std::string>(current))
                     {
-                        (*param) = value;
+                        engine.setParameter(*param, value);
                         fmt::println("@ Setting parameter {} to {}", path, value);
                     }
                 }
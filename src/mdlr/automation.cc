@@ -0,0 +1,163 @@
+#include "mdlr/automation.h"
+#include "mdlr/fastmath.h"
+
+#include <cmath>
+
+namespace mdlr
+{
+    // Frames p = 1..n after `start` of a segment of `length` frames from a to b. Every frame
+    // is computed from the segment start so the loops vectorize.
+    static void segment(Signal* out, int n, float start, float length, Signal a, Signal b, Breakpoint::Shape shape)
+    {
+        using Shape = Breakpoint::Shape;
+        if (shape == Shape::step)
+        {
+            std::fill_n(out, n, a);
+            if (start + float(n) >= length)
+                out[n - 1] = b;
+            return;
+        }
+
+        const bool exponential = shape == Shape::exponential && a * b > 0.f;
+        const float from = exponential ? std::log2(std::abs(a)) : a;
+        const float to = exponential ? std::log2(std::abs(b)) : b;
+        const float slope = (to - from) / length;
+        for (int f = 0; f < n; f++)
+            out[f] = from + slope * (start + float(f + 1));
+        if (!exponential)
+            return;
+
+        fastmath::exp2({ out, size_t(n) }, { out, size_t(n) });
+        if (a < 0.f)
+            for (int f = 0; f < n; f++)
+                out[f] = -out[f];
+    }
+
+    bool Lane::render(int frames)
+    {
+        Signal* out = output.buffer.data();
+        const auto curve = points();
+        const Signal previous = value;
+        int f = 0;
+        while (f < frames && next < curve.size())
+        {
+            const auto& point = curve[next];
+            if (point.offset > position)
+            {
+                const int n = int(std::min<uint64_t>(point.offset - position, frames - f));
+                segment(out + f, n, float(position - begin), float(point.offset - begin), from, point.value, point.shape);
+                position += n;
+                f += n;
+                value = out[f - 1];
+            }
+            if (point.offset <= position)
+            {
+                from = value = point.value;
+                begin = point.offset;
+                next++;
+            }
+        }
+
+        // Past the end the output holds the last value, the lane stops after a whole constant block
+        const bool ended = f == 0;
+        std::fill(output.buffer.begin() + f, output.buffer.end(), value);
+        output.signal = value;
+        output.data = out;
+        if (parameter && (f > 0 || value != previous))
+            parameter->set(integer ? ParameterValue(int(std::lround(value))) : ParameterValue(value));
+        return !ended;
+    }
+
+    void Automation::prepare(int blocksize)
+    {
+        this->blocksize = blocksize;
+        for (auto& lane: lanes)
+            lane->output.buffer.assign(blocksize, lane->value);
+    }
+
+    Lane& Automation::add(Signal value)
+    {
+        auto& lane = *lanes.emplace_back(std::make_unique<Lane>());
+        lane.value = value;
+        lane.from = value;
+        lane.output.name = "automation";
+        lane.output.signal = value;
+        lane.output.buffer.assign(blocksize, value);
+        lane.output.data = lane.output.buffer.data();
+        return lane;
+    }
+
+    Lane& Automation::attach(Slot& input)
+    {
+        auto& lane = add(input.signal);
+        lane.output.connect(input);
+        lane.input = &input;
+        return lane;
+    }
+
+    Lane* Automation::attach(Parameter& parameter)
+    {
+        const ParameterValue current = parameter;
+        const bool integer = std::holds_alternative<int>(current);
+        if (parameter.staged || !(integer || std::holds_alternative<float>(current)))
+            return nullptr;
+
+        auto& lane = add(integer ? Signal(std::get<int>(current)) : std::get<float>(current));
+        lane.parameter = &parameter;
+        lane.integer = integer;
+        return &lane;
+    }
+
+    void Automation::start(Lane& lane, Memory& curve)
+    {
+        std::swap(lane.curve, curve);
+        lane.next = 0;
+        lane.position = 0;
+        lane.begin = 0;
+        lane.from = lane.value;
+        if (!lane.running)
+        {
+            lane.running = true;
+            lane.link = running;
+            running = &lane;
+        }
+    }
+
+    void Automation::process(int frames)
+    {
+        Lane** previous = &running;
+        while (Lane* lane = *previous)
+        {
+            if (lane->render(frames))
+            {
+                previous = &lane->link;
+                continue;
+            }
+            lane->running = false;
+            *previous = lane->link;
+            lane->link = nullptr;
+        }
+    }
+
+    void Automation::detach(Lane& lane, Memory& curve)
+    {
+        std::swap(lane.curve, curve);
+        lane.parameter = nullptr;
+        if (lane.running)
+            unlink(lane);
+    }
+
+    void Automation::unlink(Lane& lane)
+    {
+        for (Lane** previous = &running; *previous; previous = &(*previous)->link)
+        {
+            if (*previous == &lane)
+            {
+                *previous = lane.link;
+                break;
+            }
+        }
+        lane.link = nullptr;
+        lane.running = false;
+    }
+}
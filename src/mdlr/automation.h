@@ -0,0 +1,84 @@
+#pragma once
+
+#include "mdlr/module.h"
+#include "mdlr/memory.h"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace mdlr
+{
+    // Point of an automation curve: `value` is reached `offset` frames after the curve
+    // starts, coming from the previous point (or the lane's value) along `shape`
+    struct Breakpoint
+    {
+        enum class Shape: uint8_t
+        {
+            step,           // holds the previous value, then jumps on the point
+            linear,
+            exponential,    // constant ratio per frame, linear when the ends differ in sign or touch 0
+        };
+
+        uint32_t offset = 0;
+        Signal value = 0.f;
+        Shape shape = Shape::linear;
+    };
+
+    // Curve driving one input or parameter. An input gets the lane's output wired into it and
+    // reads a block rendered frame by frame, parameters are set to the value the block ends on.
+    // Parameters are set directly on the audio thread, so only int and float ones that are not
+    // staging (see Parameter::staging) can be automated.
+    struct Lane
+    {
+        Slot output;
+        Slot* input = nullptr;      // wired to the output by Automation::attach
+        Parameter* parameter = nullptr;
+        bool integer = false;       // the parameter holds an int, values are rounded
+        Signal value = 0.f;
+
+        // Audio thread: the curve being played, swapped in by Automation::start()
+        Memory curve;
+        uint32_t next = 0;
+        uint64_t position = 0;      // frames since the curve started
+        uint64_t begin = 0;         // position of the previous point
+        Signal from = 0.f;          // value of the previous point
+        Lane* link = nullptr;
+        bool running = false;
+
+        std::span<const Breakpoint> points() const { return { (const Breakpoint*) curve.data, curve.size / sizeof(Breakpoint) }; }
+
+        // Renders `frames` of the curve into the output and returns false once it has ended
+        // and the output holds a constant block of the final value
+        bool render(int frames);
+    };
+
+    // Lanes live as long as the automation, so the audio thread never sees one freed, detached
+    // ones included. Curves reach the audio thread through the engine's command queue (see
+    // Engine::automate), lanes with a curve in progress are linked in a list walked once per block.
+    struct Automation
+    {
+        std::vector<std::unique_ptr<Lane>> lanes;
+        int blocksize = 0;
+
+        // Control thread. Wiring a lane into an input is a graph edit, the lane drives it
+        // after the next Engine::commit(). Its sum with other sources reaches the input.
+        void prepare(int blocksize);
+        Lane& attach(Slot& input);
+        Lane* attach(Parameter& parameter);     // nullptr when the parameter can't be automated
+
+        // Audio thread: replaces the lane's curve, the previous one goes back in `curve`
+        void start(Lane& lane, Memory& curve);
+        void process(int frames);
+
+        // Audio thread: stops the lane for good and lets go of its parameter, the curve goes
+        // back in `curve`. Its wire is unplugged on the control thread, see Engine::detach.
+        void detach(Lane& lane, Memory& curve);
+
+    private:
+        Lane* running = nullptr;
+        Lane& add(Signal value);
+        void unlink(Lane& lane);
+    };
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "mdlr/module.h"
+#include "mdlr/memory.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mdlr
+{
+    struct Lane;
+
+    // Graph edit published to the audio thread in one go: the plans compiled for every
+    // group of the edited tree, and the modules taken out of it, which must outlive the
+    // plans being replaced. Once applied it holds the replaced plans instead.
+    struct Edit
+    {
+        Plans plans;                                            // nested groups first
+        std::vector<std::unique_ptr<Module>> removed;
+        int crossfade = 0;                                      // in frames
+    };
+
+    // Message from the control thread to the audio thread. Commands are applied in
+    // order, at the engine frame given by `time` (0 means as soon as possible).
+    struct Command
+    {
+        enum class Type
+        {
+            set_signal,
+            set_parameter,
+            call,
+            commit,
+            automate,
+            detach
+        };
+
+        using Method = void (*)(Module*, Command&);
+
+        Type type = Type::set_signal;
+        uint64_t time = 0;
+        Slot* slot = nullptr;
+        Parameter* parameter = nullptr;
+        Module* module = nullptr;
+        Lane* lane = nullptr;
+        Signal signal = 0.f;
+        ParameterValue value;
+        Method method = nullptr;
+        int argument = 0;
+
+        // Prepared on the control thread and swapped in by the audio thread. Whatever
+        // is swapped out travels back with the command and is freed off the audio thread.
+        Memory payload;
+
+        // Swapped in by the audio thread and freed when the command comes back, like the payload
+        std::unique_ptr<Edit> edit;
+    };
+}
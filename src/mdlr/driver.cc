@@ -6,6 +6,9 @@
 
 #endif // defined(MDLR_USE_MINIAUDIO)
 
+#include "mdlr/offline.cc.inl"
+#include "mdlr/null.cc.inl"
+
 namespace mdlr
 {
     std::unique_ptr<Driver> Driver::create(DriverBackend backend)
@@ -16,6 +19,10 @@ namespace mdlr
             case DriverBackend::Miniaudio:
                 return std::unique_ptr<Driver>(new MiniaudioDriver());
         #endif // defined(MDLR_USE_MINIAUDIO)
+            case DriverBackend::Offline:
+                return std::unique_ptr<Driver>(new OfflineDriver());
+            case DriverBackend::Null:
+                return std::unique_ptr<Driver>(new NullDriver());
             default:
                 break;
         }
@@ -1,15 +1,19 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <memory>
 #include <functional>
+#include <vector>
 
 namespace mdlr
 {
     enum class DriverBackend
     {
-        Miniaudio
+        Miniaudio,
+        Offline,
+        Null
     };
 
     struct DeviceID
@@ -35,12 +39,29 @@ namespace mdlr
     {
         struct {
             DeviceSelector selector = { .any = false };
+            int channels = 8;
         } capture;
         struct {
             DeviceSelector selector = { .any = true };
+            int channels = 8;
         } playback;
         int samplerate = DefaultSampleRate;
         int buffersize = DefaultBufferSize;
+        DriverBackend backend = DriverBackend::Miniaudio;
+
+        // Faster than realtime rendering, see DriverBackend::Offline
+        struct {
+            std::string input;                      // .wav or raw interleaved float32, optional
+            std::string output;                     // .wav or raw interleaved float32, optional
+            std::vector<float>* buffer = nullptr;   // interleaved output kept in memory, optional
+            int64_t frames = 0;                     // render length, 0 to follow the input length
+        } offline;
+
+        // Simulated device clock, see DriverBackend::Null
+        struct {
+            bool sleep = true;                      // pace callbacks to real time
+            bool loopback = false;                  // feed each period's outputs to the next inputs
+        } null;
     };
 
     struct Driver
@@ -59,11 +80,17 @@ namespace mdlr
         int buffersize = DefaultBufferSize;
         Callback callback;
 
+        // Underruns/overruns reported or detected by the backend
+        std::atomic<uint64_t> xruns = 0;
+
         virtual ~Driver() = default;
         virtual bool configure(const DriverConfiguration&) = 0;
         virtual void start() = 0;
         virtual void stop() = 0;
 
+        // Non realtime drivers render synchronously from start()
+        virtual bool realtime() const { return true; }
+
         static std::unique_ptr<Driver> create(DriverBackend);
     };
 }
\ No newline at end of file
@@ -2,73 +2,382 @@
 
 #include "mdlr/driver.h"
 #include "mdlr/module.h"
+#include "mdlr/command.h"
+#include "mdlr/automation.h"
+#include "mdlr/queue.h"
+#include "mdlr/log.h"
+#include "mdlr/stats.h"
+#include "mdlr/smoothing.h"
+#include "mdlr/scheduler.h"
+#include "mdlr/wavetable.h"
 
 #include <memory>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 
 namespace mdlr
 {
     struct Engine
     {
+        // Declared before the driver so it outlives the audio callback
+        std::unique_ptr<Scheduler> scheduler;
         std::unique_ptr<Driver> driver;
         Group system;
+        Automation automation;
         struct {
-            float target = 0.f;
-            float current = 0.f;
+            std::atomic<float> target = 0.f;
+            std::atomic<float> current = 0.f;
+            Smoother ramp;      // audio thread only
         } volume;
 
-        bool init(DriverConfiguration configuration = {})
+        // Control -> audio commands, and the applied ones coming back to be freed
+        SpscQueue<Command> commands { 1024 };
+        SpscQueue<Command> retired { 1024 };
+        std::atomic<uint64_t> time = 0;
+        CallbackStats stats;
+
+        // Audio thread only: the graph replaced by the last commit, still played while it
+        // fades out, and the new graph's outputs while they are mixed
+        struct {
+            std::unique_ptr<Edit> edit;
+            int position = 0;
+            std::vector<Signal> buffer;
+        } fade;
+
+        // `threads` above 1 runs independent parts of the system group in parallel
+        bool init(DriverConfiguration configuration = {}, int threads = 1)
         {
-            driver = Driver::create(DriverBackend::Miniaudio);
+            // Start the log thread before any realtime thread can post to it,
+            // and build the shared wavetables before any module asks for them
+            Log::instance();
+            WavetableBank::instance();
+
+            driver = Driver::create(configuration.backend);
+            if (!driver)
+                return false;
             driver->callback = [&](const float* ins, float* outs, int frames) { this->callback(ins, outs, frames); };
             if (!driver->configure(configuration))
                 return false;
 
+            // Device channels are named so patches can wire to them
             system.ins.resize(driver->capture.channels);
             system.outs.resize(driver->playback.channels);
+            for (size_t c = 0; c < system.ins.size(); c++)
+                system.ins[c].name = fmt::format("in{}", c);
+            for (size_t c = 0; c < system.outs.size(); c++)
+                system.outs[c].name = fmt::format("out{}", c);
+            Module::layout++;
+            system.prepare(driver->buffersize);
+            automation.prepare(driver->buffersize);
+            fade.buffer.assign(size_t(driver->playback.channels) * driver->buffersize, 0.f);
+
+            if (threads > 1)
+            {
+                scheduler = std::make_unique<Scheduler>(threads);
+                system.scheduler = scheduler.get();
+            }
             return true;
         }
 
         void start()
         {
+            Plans plans;
+            system.compileTree(plans);
+            for (auto& [group, plan]: plans)
+                group->swap(plan);
+            if (!driver->realtime())
+            {
+                volume.target = 1.f;
+                volume.current = 1.f;
+                volume.ramp = 1.f;
+                driver->start();
+                return;
+            }
+
             driver->start();
             volume.target = 1.f;
             while (std::abs(volume.target - volume.current) > 0.01f); 
         }
         void stop()
         {
+            if (!driver->realtime())
+            {
+                driver->stop();
+                return;
+            }
+
             volume.target = 0.f;
             while (std::abs(volume.target - volume.current) > 0.01f);
             driver->stop();
         }
-        void update() {}
+
+        // Control thread: releases whatever applied commands carried back
+        void update()
+        {
+            Command command;
+            while (retired.pop(command))
+                command = {};
+        }
+
+        // Control thread: commands must be posted in time order
+        bool post(Command&& command)
+        {
+            if (command.type == Command::Type::set_parameter)
+                command.parameter->parent->prepareParameter(*command.parameter, command.value, command.payload);
+            return commands.push(std::move(command));
+        }
+
+        bool setSignal(Slot& slot, Signal value, uint64_t when = 0)
+        {
+            return post({ .type = Command::Type::set_signal, .time = when, .slot = &slot, .signal = value });
+        }
+
+        bool setParameter(Parameter& parameter, ParameterValue value, uint64_t when = 0)
+        {
+            return post({ .type = Command::Type::set_parameter, .time = when, .parameter = &parameter, .value = std::move(value) });
+        }
+
+        bool call(Module& module, Command::Method method, int argument = 0, uint64_t when = 0)
+        {
+            return post({ .type = Command::Type::call, .time = when, .module = &module, .method = method, .argument = argument });
+        }
+
+        // Control thread: replaces the lane's curve, which starts from the lane's current value
+        // when the command applies. Breakpoint offsets count frames from then.
+        bool automate(Lane& lane, std::span<const Breakpoint> curve, uint64_t when = 0)
+        {
+            Memory points = Memory::allocate(curve.size_bytes());
+            if (!curve.empty())
+                memcpy(points.data, curve.data(), curve.size_bytes());
+            return post({ .type = Command::Type::automate, .time = when, .lane = &lane, .payload = std::move(points) });
+        }
+
+        bool ramp(Lane& lane, Signal value, uint32_t frames, uint64_t when = 0)
+        {
+            const Breakpoint point = { .offset = frames, .value = value };
+            return automate(lane, { &point, 1 }, when);
+        }
+
+        // Control thread: stops the lane and drops its hold on its target, before the target's
+        // module is removed. Unplugging an input is a graph edit, published by the next commit.
+        // The lane itself stays allocated, see Automation.
+        bool detach(Lane& lane, uint64_t when = 0)
+        {
+            if (!post({ .type = Command::Type::detach, .time = when, .lane = &lane }))
+                return false;
+            if (lane.input)
+                lane.output.disconnect(*lane.input);
+            lane.input = nullptr;
+            return true;
+        }
+
+        // Control thread: publishes the edits made to the system since the last commit. The
+        // whole tree is compiled here and swapped in by the audio thread between two blocks,
+        // the modules `removed` from it (Group::remove/clear) are freed once the replaced plans
+        // come back. When the queue is full nothing is published and `removed` is handed back.
+        // A crossfade keeps playing the replaced graph while fading to the new one. It is meant
+        // for edits that replace modules, like switching sets: modules kept on both sides would
+        // be processed twice per block while it lasts.
+        bool commit(std::vector<std::unique_ptr<Module>>&& removed = {}, int crossfade = 0, uint64_t when = 0)
+        {
+            auto edit = std::make_unique<Edit>();
+            system.compileTree(edit->plans);
+            edit->removed = std::move(removed);
+            edit->crossfade = crossfade;
+
+            Command command { .type = Command::Type::commit, .time = when, .edit = std::move(edit) };
+            if (post(std::move(command)))
+                return true;
+            removed = std::move(command.edit->removed);
+            return false;
+        }
+
+        // Audio thread: applies the commands due before `frames` more frames are rendered
+        // and returns how many frames can run before the next pending one
+        int dispatch(int frames)
+        {
+            const uint64_t now = time.load(std::memory_order_relaxed);
+            while (Command* next = commands.front())
+            {
+                if (next->time > now)
+                {
+                    if (next->time < now + frames)
+                        frames = int(next->time - now);
+                    break;
+                }
+
+                // A command hands back itself and at most one finished crossfade. Without room
+                // for both it waits for update() to drain the retired queue, as dropping them
+                // would free their contents here.
+                if (retired.capacity() - retired.size() < 2)
+                    break;
+
+                Command command = std::move(*next);
+                commands.pop();
+                apply(command);
+                retired.push(std::move(command));
+            }
+            return frames;
+        }
+
+        void apply(Command& command)
+        {
+            switch (command.type)
+            {
+                case Command::Type::set_signal:
+                    command.slot->signal = command.signal;
+                    break;
+
+                case Command::Type::set_parameter:
+                    command.parameter->parent->applyParameter(*command.parameter, std::move(command.value), command.payload);
+                    break;
+
+                case Command::Type::call:
+                    command.method(command.module, command);
+                    break;
+
+                case Command::Type::automate:
+                    automation.start(*command.lane, command.payload);
+                    break;
+
+                case Command::Type::detach:
+                    automation.detach(*command.lane, command.payload);
+                    break;
+
+                case Command::Type::commit:
+                    for (auto& [group, plan]: command.edit->plans)
+                        group->swap(plan);
+                    if (command.edit->crossfade > 0)
+                    {
+                        if (fade.edit)
+                            retire(fade.edit);
+                        fade.edit = std::move(command.edit);
+                        fade.position = 0;
+                    }
+                    break;
+            }
+        }
+
+        // Audio thread: plays the graph replaced by the last commit over the same frames and
+        // mixes from it to the new one, then hands it back to be freed
+        void crossfade(int frames)
+        {
+            // Over, only waiting for room in the retired queue
+            if (fade.position >= fade.edit->crossfade)
+                return (void) retire(fade.edit);
+
+            const int channels = int(system.outs.size());
+            const int stride = system.blocksize;
+            for (int c = 0; c < channels; c++)
+                std::copy_n(system.outs[c].data, frames, fade.buffer.data() + c * stride);
+
+            auto& previous = fade.edit->plans.back().second;
+            std::swap(system.plan, previous);
+            system.processBlock(driver->samplerate, frames);
+            std::swap(system.plan, previous);
+
+            const float length = float(fade.edit->crossfade);
+            for (int c = 0; c < channels; c++)
+            {
+                Signal* mix = fade.buffer.data() + c * stride;
+                const Signal* old = system.outs[c].data;
+                for (int f = 0; f < frames; f++)
+                {
+                    const float t = std::min(float(fade.position + f + 1) / length, 1.f);
+                    mix[f] = old[f] + t * (mix[f] - old[f]);
+                }
+                system.outs[c].data = mix;
+            }
+
+            fade.position += frames;
+            if (fade.position >= fade.edit->crossfade)
+                retire(fade.edit);
+        }
+
+        // Audio thread: hands an edit back to be freed, leaving it in place when the retired
+        // queue is full so it is never freed here
+        bool retire(std::unique_ptr<Edit>& edit)
+        {
+            if (retired.size() == retired.capacity())
+                return false;
+            return retired.push({ .type = Command::Type::commit, .edit = std::move(edit) });
+        }
+
+        std::string statsString() const { return stats.string(driver->xruns.load(std::memory_order_relaxed)); }
 
         void callback(const float* ins, float* outs, int frames)
         {
+            const auto start = std::chrono::steady_clock::now();
             if (outs)
                 memset(outs, 0, driver->playback.channels * frames * sizeof(float));
 
-            for (int f = 0; f < frames; f++)
+            auto& clock = Module::clock;
+            const int64_t stamp = std::chrono::duration_cast<std::chrono::nanoseconds>(start.time_since_epoch()).count();
+            clock.previous = clock.period ? clock.period : stamp;
+            clock.period = stamp;
+            clock.start = time.load(std::memory_order_relaxed);
+            clock.frames = frames;
+
+            const int inchannels = driver->capture.channels;
+            const int outchannels = driver->playback.channels;
+            const float target = volume.target.load(std::memory_order_relaxed);
+            auto& ramp = volume.ramp;
+            ramp.prepare(driver->samplerate, 70.f);
+
+            int count = 0;
+            for (int offset = 0; offset < frames; offset += count)
             {
-                if (ins)
+                count = dispatch(std::min(system.blocksize, frames - offset));
+                clock.frame = clock.start + offset;
+
+                for (int c = 0; c < inchannels; c++)
                 {
-                    for (int c = 0; c < driver->capture.channels; c++)
+                    auto& slot = system.ins[c];
+                    if (ins)
                     {
-                        system.ins[c] = ins[f*driver->capture.channels + c];
-                        system.ins[c].propagate();
-                    }
+                        for (int f = 0; f < count; f++)
+                            slot.buffer[f] = ins[(offset + f)*inchannels + c];
+                    } else
+                        slot.fill(count);
                 }
-                
-                system.process(driver->samplerate);
 
-                if (outs)
+                automation.process(count);
                 {
-                    for (int c = 0; c < driver->playback.channels; c++)
-                        outs[f*driver->playback.channels + c] = volume.current * system.outs[c];
+                    MDLR_PROFILE_SCOPE(system.profile, count);
+                    system.processBlock(driver->samplerate, count);
+                    if (fade.edit)
+                        crossfade(count);
                 }
 
-                const float lerpfac = 70.f / driver->samplerate;
-                volume.current = volume.current * (1.f - lerpfac) + volume.target * lerpfac;
+                if (outs && ramp.settle(target))
+                {
+                    for (int c = 0; c < outchannels; c++)
+                    {
+                        const Signal* data = system.outs[c].data;
+                        for (int f = 0; f < count; f++)
+                            outs[(offset + f)*outchannels + c] = ramp.value * data[f];
+                    }
+                }
+                else
+                {
+                    for (int f = 0; f < count; f++)
+                    {
+                        const float gain = ramp.next(target);
+                        if (outs)
+                        {
+                            for (int c = 0; c < outchannels; c++)
+                                outs[(offset + f)*outchannels + c] = gain * system.outs[c].data[f];
+                        }
+                    }
+                }
+                time.fetch_add(count, std::memory_order_relaxed);
             }
+
+            volume.current.store(ramp.value, std::memory_order_relaxed);
+
+            const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            stats.record(elapsed, double(frames) / driver->samplerate);
         }
     };
 }
\ No newline at end of file
@@ -0,0 +1,96 @@
+#include "mdlr/fastmath.h"
+
+namespace mdlr::fastmath
+{
+    // Same scheme as simd.cc: one plain loop per function, instantiated for the baseline
+    // and for AVX2/FMA, picked once at startup. In-place calls get their own loop since
+    // the compiler cannot vectorize when it has to assume partial overlap.
+    using Kernel = void (*)(const float*, float*, size_t);
+
+    template <float (*F)(float)>
+    static inline void apply(const float* x, float* out, size_t count)
+    {
+        if (x == out)
+        {
+            for (size_t i = 0; i < count; i++)
+                out[i] = F(out[i]);
+            return;
+        }
+        const float* __restrict in = x;
+        float* __restrict result = out;
+        for (size_t i = 0; i < count; i++)
+            result[i] = F(in[i]);
+    }
+
+    template <float (*F)(float)>
+    static void generic(const float* x, float* out, size_t count) { apply<F>(x, out, count); }
+
+#if (defined(__x86_64__) || defined(_M_X64)) && (defined(__GNUC__) || defined(__clang__))
+    #define MDLR_FASTMATH_AVX2
+
+    template <float (*F)(float)>
+    __attribute__((target("avx2,fma"))) static void avx2(const float* x, float* out, size_t count) { apply<F>(x, out, count); }
+#endif
+
+    static float scalarExp2(float x) { return exp2(x); }
+    static float scalarLog2(float x) { return log2(x); }
+    static float scalarExp(float x) { return exp(x); }
+    static float scalarLog(float x) { return log(x); }
+    static float scalarTanh(float x) { return tanh(x); }
+    static float scalarSin(float x) { return sin(x); }
+    static float scalarCos(float x) { return cos(x); }
+
+    struct Dispatch
+    {
+        Kernel exp2 = &generic<scalarExp2>;
+        Kernel log2 = &generic<scalarLog2>;
+        Kernel exp = &generic<scalarExp>;
+        Kernel log = &generic<scalarLog>;
+        Kernel tanh = &generic<scalarTanh>;
+        Kernel sin = &generic<scalarSin>;
+        Kernel cos = &generic<scalarCos>;
+
+        Dispatch()
+        {
+        #if defined(MDLR_FASTMATH_AVX2)
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            {
+                exp2 = &avx2<scalarExp2>;
+                log2 = &avx2<scalarLog2>;
+                exp = &avx2<scalarExp>;
+                log = &avx2<scalarLog>;
+                tanh = &avx2<scalarTanh>;
+                sin = &avx2<scalarSin>;
+                cos = &avx2<scalarCos>;
+            }
+        #endif
+        }
+    };
+
+    static const Dispatch dispatch;
+
+    void exp2(std::span<const float> x, std::span<float> out) { dispatch.exp2(x.data(), out.data(), x.size()); }
+    void log2(std::span<const float> x, std::span<float> out) { dispatch.log2(x.data(), out.data(), x.size()); }
+    void exp(std::span<const float> x, std::span<float> out) { dispatch.exp(x.data(), out.data(), x.size()); }
+    void log(std::span<const float> x, std::span<float> out) { dispatch.log(x.data(), out.data(), x.size()); }
+    void tanh(std::span<const float> x, std::span<float> out) { dispatch.tanh(x.data(), out.data(), x.size()); }
+    void sin(std::span<const float> x, std::span<float> out) { dispatch.sin(x.data(), out.data(), x.size()); }
+    void cos(std::span<const float> x, std::span<float> out) { dispatch.cos(x.data(), out.data(), x.size()); }
+
+    void pow(std::span<const float> x, float y, std::span<float> out)
+    {
+        dispatch.log2(x.data(), out.data(), x.size());
+        for (auto& v: out.first(x.size()))
+            v *= y;
+        dispatch.exp2(out.data(), out.data(), x.size());
+    }
+
+    void mtof(std::span<const float> note, std::span<float> out, float root)
+    {
+        for (size_t i = 0; i < note.size(); i++)
+            out[i] = (note[i] - 69.f) * (1.f / 12.f);
+        dispatch.exp2(out.data(), out.data(), note.size());
+        for (auto& v: out.first(note.size()))
+            v *= root;
+    }
+}
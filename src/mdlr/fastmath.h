@@ -0,0 +1,77 @@
+#pragma once
+
+#include "mdlr/simd.h"
+
+#include <bit>
+#include <cstdint>
+#include <span>
+
+namespace mdlr::fastmath
+{
+    // Branchless approximations of the transcendentals used on the audio path, meant to
+    // be inlined in loops the compiler vectorizes. Inputs are expected to be finite, no
+    // NaN/inf handling is done. Measured error bounds (tests/fastmath.cc):
+    //  exp2            relative 2e-7, input clamped to [-126, 126]
+    //  exp             relative 2e-7 + 6e-8 * |x| from rounding x * log2(e)
+    //  log2            absolute 3e-7, then the float resolution of the result
+    //  pow             exp2(y * log2(x)) for x > 0, relative 2e-6 for moderate results
+    //  tanh            absolute 5e-7
+    //  sin, cos        absolute 5e-7 over [-pi, pi], then the rounding of x / 2pi
+    //  mtof            relative 6e-7
+
+    // Clamp that compiles to a select: a ternary gets jump-threaded by GCC into branches
+    // around the trapping float ops that follow, which then blocks vectorization
+    inline float clamp(float x, float lo, float hi)
+    {
+        return x + float(x < lo) * (lo - x) + float(x > hi) * (hi - x);
+    }
+
+    inline float exp2(float x)
+    {
+        x = clamp(x, -126.f, 126.f);
+        const int32_t i = int32_t(x + 128.f) - 128;
+        const float f = x - float(i);
+        const float p = 0.99999994f + f * (0.693152964f + f * (0.240154535f + f * (0.0558236055f + f * (0.00899258442f + f * 0.00187623291f))));
+        return p * std::bit_cast<float>((i + 127) << 23);
+    }
+
+    inline float log2(float x)
+    {
+        // Splits x around sqrt(1/2) so that the mantissa lands in [sqrt(1/2), sqrt(2))
+        // and t stays small
+        const int32_t bits = std::bit_cast<int32_t>(x) - 0x3F3504F3;
+        const float e = float(bits >> 23);
+        const float m = std::bit_cast<float>((bits & 0x007FFFFF) + 0x3F3504F3);
+
+        const float t = (m - 1.f) / (m + 1.f);
+        const float t2 = t * t;
+        return e + t * (2.88539004f + t2 * (0.961798847f + t2 * (0.576715052f + t2 * 0.431720555f)));
+    }
+
+    inline float exp(float x) { return exp2(x * 1.44269504f); }
+    inline float log(float x) { return log2(x) * 0.693147181f; }
+    inline float pow(float x, float y) { return exp2(y * log2(x)); }
+
+    inline float tanh(float x)
+    {
+        x = clamp(x, -9.f, 9.f);
+        return 1.f - 2.f / (exp2(x * 2.88539008f) + 1.f);
+    }
+
+    inline float sin(float x) { return simd::sine<simd::Accuracy::precise>(simd::wrap(x * 0.159154943f)); }
+    inline float cos(float x) { return simd::sine<simd::Accuracy::precise>(simd::wrap(x * 0.159154943f + 0.25f)); }
+
+    // MIDI note (fractional for pitch bends) to frequency
+    inline float mtof(float note, float root = 440.f) { return root * exp2((note - 69.f) * (1.f / 12.f)); }
+
+    // Batch versions, dispatched like the simd kernels. `out` may alias the input.
+    void exp2(std::span<const float> x, std::span<float> out);
+    void log2(std::span<const float> x, std::span<float> out);
+    void exp(std::span<const float> x, std::span<float> out);
+    void log(std::span<const float> x, std::span<float> out);
+    void pow(std::span<const float> x, float y, std::span<float> out);
+    void tanh(std::span<const float> x, std::span<float> out);
+    void sin(std::span<const float> x, std::span<float> out);
+    void cos(std::span<const float> x, std::span<float> out);
+    void mtof(std::span<const float> note, std::span<float> out, float root = 440.f);
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <numbers>
+#include <vector>
+
+namespace mdlr
+{
+    // Linear phase half-band lowpass split in its two polyphase branches: a pure delay
+    // (the 0.5 centre tap) and `taps` odd taps (even count), every other tap of a
+    // half-band being zero. Kaiser windowed sinc, normalized for unity gain at DC.
+    inline std::vector<float> halfband(int taps, double beta = 9.)
+    {
+        auto bessel = [](double x)
+        {
+            double sum = 1., term = 1.;
+            for (int k = 1; k < 32; k++)
+            {
+                term *= x / (2. * k);
+                sum += term * term;
+            }
+            return sum;
+        };
+
+        std::vector<float> coefficients(taps);
+        std::vector<double> exact(taps);
+        double sum = 0.;
+        for (int i = 0; i < taps; i++)
+        {
+            const double o = 2 * i - (taps - 1);
+            const double r = o / taps;
+            const double window = bessel(beta * std::sqrt(1. - r * r)) / bessel(beta);
+            exact[i] = std::sin(std::numbers::pi * o / 2.) / (std::numbers::pi * o) * window;
+            sum += exact[i];
+        }
+        for (int i = 0; i < taps; i++)
+            coefficients[i] = float(exact[i] * 0.5 / sum);
+        return coefficients;
+    }
+
+    // 2x interpolator: even outputs are the delayed input, odd outputs the FIR branch.
+    // Latency is taps / 2 input samples.
+    struct HalfbandUpsampler
+    {
+        std::vector<float> coefficients;
+        std::vector<float> history;     // taps - 1 previous inputs, then the block
+
+        void prepare(int taps, int blocksize)
+        {
+            coefficients = halfband(taps);
+            history.assign(taps - 1 + blocksize, 0.f);
+        }
+
+        // `out` holds 2 * frames samples
+        void process(const float* in, float* out, int frames)
+        {
+            const int taps = int(coefficients.size());
+            const float* c = coefficients.data();
+            float* x = history.data() + taps - 1;
+            memcpy(x, in, frames * sizeof(float));
+
+            for (int n = 0; n < frames; n++)
+            {
+                float acc = 0.f;
+                for (int i = 0; i < taps; i++)
+                    acc += c[i] * x[n - i];
+                out[2*n] = x[n - taps / 2];
+                out[2*n + 1] = 2.f * acc;
+            }
+            memmove(history.data(), history.data() + frames, (taps - 1) * sizeof(float));
+        }
+    };
+
+    // 2x decimator: odd inputs go through the FIR branch, even inputs through the delay.
+    // Latency is taps / 2 output samples.
+    struct HalfbandDownsampler
+    {
+        std::vector<float> coefficients;
+        std::vector<float> evens;       // taps / 2 previous even inputs, then the block
+        std::vector<float> odds;        // taps previous odd inputs, then the block
+
+        void prepare(int taps, int blocksize)
+        {
+            coefficients = halfband(taps);
+            evens.assign(taps / 2 + blocksize, 0.f);
+            odds.assign(taps + blocksize, 0.f);
+        }
+
+        // `in` holds 2 * frames samples
+        void process(const float* in, float* out, int frames)
+        {
+            const int taps = int(coefficients.size());
+            const float* c = coefficients.data();
+            float* e = evens.data() + taps / 2;
+            float* o = odds.data() + taps;
+            for (int m = 0; m < frames; m++)
+            {
+                e[m] = in[2*m];
+                o[m] = in[2*m + 1];
+            }
+
+            for (int m = 0; m < frames; m++)
+            {
+                float acc = 0.f;
+                for (int i = 0; i < taps; i++)
+                    acc += c[i] * o[m - 1 - i];
+                out[m] = 0.5f * e[m - taps / 2] + acc;
+            }
+            memmove(evens.data(), evens.data() + frames, (taps / 2) * sizeof(float));
+            memmove(odds.data(), odds.data() + frames, taps * sizeof(float));
+        }
+    };
+}
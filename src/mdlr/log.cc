@@ -0,0 +1,76 @@
+#include "mdlr/log.h"
+
+#include <chrono>
+
+namespace mdlr
+{
+    static constexpr std::string_view categories[] = {
+        "engine",
+        "driver",
+        "audio",
+        "midi",
+    };
+    static_assert(std::size(categories) == size_t(LogCategory::count));
+
+    std::string_view name(LogCategory category) { return categories[uint32_t(category)]; }
+
+    bool parse(std::string_view name, LogCategory& category)
+    {
+        for (uint32_t i = 0; i < uint32_t(LogCategory::count); i++)
+        {
+            if (categories[i] == name)
+            {
+                category = LogCategory(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    Log::Log()
+    {
+        running = true;
+        thread = std::thread([this]()
+        {
+            while (running.load(std::memory_order_relaxed))
+            {
+                flush();
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+            flush();
+        });
+    }
+
+    Log::~Log()
+    {
+        running = false;
+        if (thread.joinable())
+            thread.join();
+    }
+
+    Log& Log::instance()
+    {
+        static Log log;
+        return log;
+    }
+
+    void Log::flush()
+    {
+        LogRecord record;
+        bool written = false;
+        while (records.pop(record))
+        {
+            fmt::print(output, "[{}] {}\n", name(record.category), std::string_view(record.text, record.length));
+            written = true;
+        }
+
+        if (uint64_t lost = dropped.exchange(0, std::memory_order_relaxed))
+        {
+            fmt::print(output, "[log] {} records dropped\n", lost);
+            written = true;
+        }
+
+        if (written)
+            fflush(output);
+    }
+}
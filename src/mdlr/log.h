@@ -0,0 +1,86 @@
+#pragma once
+
+#include "mdlr/queue.h"
+
+#include <fmt/format.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <thread>
+
+namespace mdlr
+{
+    enum class LogCategory: uint32_t
+    {
+        engine,
+        driver,
+        audio,
+        midi,
+
+        count
+    };
+
+    std::string_view name(LogCategory category);
+    bool parse(std::string_view name, LogCategory& category);
+
+    // Fixed-size record formatted in place by the producer, nothing is allocated
+    struct LogRecord
+    {
+        LogCategory category = LogCategory::engine;
+        uint32_t length = 0;
+        char text[248];
+    };
+
+    // Realtime-safe trace channel: any thread (audio, MIDI, control) posts preformatted
+    // records into a lock-free ring, a background thread writes them out. Records are
+    // dropped, and counted, when the ring is full.
+    struct Log
+    {
+        MpscQueue<LogRecord> records { 4096 };
+        std::atomic<uint32_t> mask = ~0u;
+        std::atomic<uint64_t> dropped = 0;
+        std::atomic<bool> running = false;
+        std::thread thread;
+        FILE* output = stdout;
+
+        Log();
+        ~Log();
+
+        static Log& instance();
+
+        bool enabled(LogCategory category) const { return mask.load(std::memory_order_relaxed) & (1u << uint32_t(category)); }
+        void enable(LogCategory category, bool on = true)
+        {
+            if (on)
+                mask.fetch_or(1u << uint32_t(category), std::memory_order_relaxed);
+            else
+                mask.fetch_and(~(1u << uint32_t(category)), std::memory_order_relaxed);
+        }
+
+        template <typename ... Args>
+        void post(LogCategory category, fmt::format_string<Args...> format, Args&& ... args)
+        {
+            if (!enabled(category))
+                return;
+
+            // Left uninitialized but for the category, the text is written just below
+            LogRecord record;
+            record.category = category;
+            auto result = fmt::format_to_n(record.text, sizeof(record.text), format, std::forward<Args>(args)...);
+            record.length = uint32_t(std::min(result.size, sizeof(record.text)));
+            if (!records.push(std::move(record)))
+                dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // Writes out everything posted so far, called by the background thread
+        void flush();
+    };
+
+    template <typename ... Args>
+    void trace(LogCategory category, fmt::format_string<Args...> format, Args&& ... args)
+    {
+        Log::instance().post(category, format, std::forward<Args>(args)...);
+    }
+}
@@ -5,7 +5,12 @@
 
 #include <fmt/format.h>
 
+#include <atomic>
+#include <chrono>
+
+#if defined(__APPLE__)
 #include <CoreAudio/CoreAudio.h>
+#endif // defined(__APPLE__)
 
 namespace mdlr
 {
@@ -13,6 +18,9 @@ namespace mdlr
     {
         ma_context context;
         ma_device device;
+        // steady_clock ns of the previous data callback, 0 once the device (re)starts. Written
+        // by the audio thread and reset by miniaudio's notification thread.
+        std::atomic<int64_t> last = 0;
 
         MiniaudioDriver()
         {
@@ -51,16 +59,17 @@ namespace mdlr
                 , &playback_device_infos, &playback_devices_count
                 , &capture_device_infos, &capture_devices_count);
 
-            ma_device_id playback_id = {};
-            ma_device_id capture_id = {};
+            // Null ids let miniaudio pick the system default device
+            const ma_device_id* playback_id = nullptr;
+            const ma_device_id* capture_id = nullptr;
             fmt::println("Available playback devices");
             for (uint32_t i = 0; i < playback_devices_count; i++)
             {
                 const auto& pdi = playback_device_infos[i];
                 ma_context_get_device_info(&context, ma_device_type_playback, &pdi.id, &playback_device_infos[i]);
                 fmt::println("- {}", pdi.name);
-                if (std::string_view(pdi.name).find("MOTU") != std::string_view::npos)
-                    playback_id = pdi.id;
+                if (matches(configuration.playback.selector, pdi))
+                    playback_id = &pdi.id;
                 for (int f = 0; f < pdi.nativeDataFormatCount; f++)
                 {
                     fmt::println("    - {}Hz, {} channels"
@@ -75,8 +84,8 @@ namespace mdlr
                 const auto& cdi = capture_device_infos[i];
                 ma_context_get_device_info(&context, ma_device_type_capture, &cdi.id, &capture_device_infos[i]);
                 fmt::println("- {}", cdi.name);
-                if (std::string_view(cdi.name).find("MOTU") != std::string_view::npos)
-                    capture_id = cdi.id;
+                if (matches(configuration.capture.selector, cdi))
+                    capture_id = &cdi.id;
                 for (int f = 0; f < cdi.nativeDataFormatCount; f++)
                 {
                     fmt::println("    - {}Hz, {} channels"
@@ -85,22 +94,29 @@ namespace mdlr
                 }
             }
 
-            ma_device_config device_config = ma_device_config_init(ma_device_type_duplex);
+            if (!configuration.playback.selector.name.empty() && !playback_id && !configuration.playback.selector.any)
+                return false;
+            if (!configuration.capture.selector.name.empty() && !capture_id && !configuration.capture.selector.any)
+                return false;
+
+            const bool duplex = configuration.capture.channels > 0;
+            ma_device_config device_config = ma_device_config_init(duplex ? ma_device_type_duplex : ma_device_type_playback);
             device_config.dataCallback = &MiniaudioDriver::datacallback;
+            device_config.notificationCallback = &MiniaudioDriver::notificationcallback;
             device_config.pUserData = this;
             device_config.periodSizeInFrames = configuration.buffersize;
             device_config.sampleRate = configuration.samplerate;
 
             // device_config.playback.channelMixMode = ma_channel_mix_mode_simple;
-            device_config.playback.channels = 8;
+            device_config.playback.channels = configuration.playback.channels;
             device_config.playback.format = ma_format_f32;
             device_config.playback.shareMode = ma_share_mode_shared;
-            device_config.playback.pDeviceID = &playback_id;
+            device_config.playback.pDeviceID = playback_id;
             // device_config.capture.channelMixMode = ma_channel_mix_mode_simple
-            device_config.capture.channels = 8;
+            device_config.capture.channels = configuration.capture.channels;
             device_config.capture.format = ma_format_f32;
             device_config.capture.shareMode = ma_share_mode_shared;
-            device_config.capture.pDeviceID = &capture_id;
+            device_config.capture.pDeviceID = capture_id;
 
             if (ma_device_init(&context, &device_config, &device) != MA_SUCCESS)
                 return false;
@@ -109,12 +125,20 @@ namespace mdlr
             buffersize = device.playback.internalPeriodSizeInFrames;
             playback.channels = device.playback.channels;
             memcpy(&playback.deviceid, &device.playback.id, sizeof(playback.deviceid));
-            capture.channels = device.capture.channels;
-            memcpy(&capture.deviceid, &device.capture.id, sizeof(capture.deviceid));
+            capture.channels = duplex ? device.capture.channels : 0;
+            if (duplex)
+                memcpy(&capture.deviceid, &device.capture.id, sizeof(capture.deviceid));
 
             return true;
         }
 
+        // A device is picked when its name contains the selector name, an empty name keeps the default.
+        // Selectors with `any` set fall back to the default device when nothing matches.
+        static bool matches(const DeviceSelector& selector, const ma_device_info& info)
+        {
+            return !selector.name.empty() && std::string_view(info.name).find(selector.name) != std::string_view::npos;
+        }
+
         virtual void start() override
         {
             if (!ma_device_is_started(&device))
@@ -134,8 +158,33 @@ namespace mdlr
             , ma_uint32 frameCount)
         {
             auto driver = (MiniaudioDriver*) pDevice->pUserData;
+
+            // miniaudio does not report xruns, so count callbacks arriving more than
+            // one and a half periods after the previous one
+            const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            const double period = double(frameCount) / pDevice->sampleRate;
+            const int64_t previous = driver->last.exchange(now, std::memory_order_relaxed);
+            if (previous != 0 && double(now - previous) * 1.e-9 > 1.5 * period)
+                driver->xruns.fetch_add(1, std::memory_order_relaxed);
+
             driver->callback((const float*) pInput, (float*) pOutput, frameCount);
         }
+
+        static void notificationcallback(const ma_device_notification* notification)
+        {
+            auto driver = (MiniaudioDriver*) notification->pDevice->pUserData;
+            switch (notification->type)
+            {
+                case ma_device_notification_type_interruption_began:
+                    driver->xruns.fetch_add(1, std::memory_order_relaxed);
+                    break;
+                case ma_device_notification_type_started:
+                    driver->last.store(0, std::memory_order_relaxed);
+                    break;
+                default:
+                    break;
+            }
+        }
     };
 
 }
\ No newline at end of file
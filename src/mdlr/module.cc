@@ -1,24 +1,69 @@
 #include "mdlr/module.h"
+#include "mdlr/scheduler.h"
 
 #include <fmt/format.h>
 
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
 namespace mdlr
 {
-    Slot& Module::addInput(std::string_view name, float defaultValue) { return ins.emplace_back(Slot { .name = name.data(), .signal = defaultValue }); }
+    Slot& Module::addInput(std::string_view name, float defaultValue)
+    {
+        layout++;
+        return ins.emplace_back(Slot { .name = name.data(), .signal = defaultValue, .buffer = std::vector<Signal>(blocksize, defaultValue) });
+    }
     void Module::addInputs(std::string_view basename, int count, float defaultValue)
     {
         for (int i = 0; i < count; i++)
             addInput(fmt::format("{}-{}", basename, i), defaultValue);
     }
-    Slot& Module::addOutput(std::string_view name, float defaultValue) { return outs.emplace_back(Slot { .name = name.data(), .signal = defaultValue }); }
+    Slot& Module::addOutput(std::string_view name, float defaultValue)
+    {
+        layout++;
+        return outs.emplace_back(Slot { .name = name.data(), .signal = defaultValue, .buffer = std::vector<Signal>(blocksize, defaultValue) });
+    }
     void Module::addOutputs(std::string_view basename, int count, float defaultValue)
     {
         for (int i = 0; i < count; i++)
             addOutput(fmt::format("{}-{}", basename, i), defaultValue);
     }
-    Parameter& Module::addParameter(std::string_view name, Parameter::Setter&& setter, Parameter::Getter&& getter)
+    Parameter& Module::addParameter(std::string_view name, ParameterValue value)
+    {
+        layout++;
+        return parameters.emplace_back(Parameter(this, name, std::move(value)));
+    }
+
+    void Module::processBlock(float samplerate, int frames)
+    {
+        for (int f = 0; f < frames; f++)
+        {
+            for (auto& s: ins)
+                s.signal = s.data[f];
+
+            process(samplerate);
+
+            for (auto& s: outs)
+                s.buffer[f] = s.signal;
+        }
+    }
+
+    void Module::prepare(int blocksize)
     {
-        return parameters.emplace_back(Parameter(this, name, std::move(setter), std::move(getter)));
+        this->blocksize = blocksize;
+        Slot::revision++;
+        for (auto& s: ins)
+        {
+            s.buffer.assign(blocksize, s.signal);
+            s.data = s.buffer.data();
+            s.constant = true;
+        }
+        for (auto& s: outs)
+        {
+            s.buffer.assign(blocksize, s.signal);
+            s.data = s.buffer.data();
+        }
     }
 
     Parameter* Module::findParameter(std::string_view path)
@@ -105,4 +150,447 @@ namespace mdlr
 
         return result;
     }
+
+    void Group::processBlock(float samplerate, int frames)
+    {
+        if (!plan.live && plan.revision != Slot::revision)
+            compile();
+
+        if (scheduler && plan.partitions.size() > 1)
+            scheduler->run(*this, samplerate, frames);
+        else
+            runSteps(0, uint32_t(plan.steps.size()), samplerate, frames);
+
+        for (const auto& output: plan.outputs)
+            plan.resolve(output, frames);
+
+        // Delay lines are written last, their consumers read them on the next block
+        for (auto& delay: plan.delays)
+            std::copy_n(delay.source->data, frames, delay.line->buffer.data());
+    }
+
+    void Group::swap(Plan& next)
+    {
+        std::swap(plan, next);
+        for (const auto& input: plan.inputs)
+            if (input.count == 0)
+                std::fill(input.slot->buffer.begin(), input.slot->buffer.end(), input.slot->signal);
+
+        for (auto& delay: plan.delays)
+        {
+            for (const auto& old: next.delays)
+            {
+                if (old.source == delay.source)
+                {
+                    std::copy_n(old.line->buffer.begin(), std::min(old.line->buffer.size(), delay.line->buffer.size()), delay.line->buffer.begin());
+                    break;
+                }
+            }
+        }
+    }
+
+    void Group::compileTree(Plans& plans)
+    {
+        for (auto& m: modules)
+            m->compileTree(plans);
+        plans.emplace_back(this, compilePlan()).second.live = true;
+    }
+
+    std::unique_ptr<Module> Group::remove(Module& module)
+    {
+        auto it = std::find_if(modules.begin(), modules.end(), [&](const auto& m) { return m.get() == &module; });
+        if (it == modules.end())
+            return nullptr;
+        auto removed = std::move(*it);
+        modules.erase(it);
+
+        // Its slots, nested ones included. What it reads from loses a consumer.
+        std::unordered_set<const Slot*> slots;
+        auto collect = [&](auto&& self, Module* m) -> void
+        {
+            for (auto list: { &m->ins, &m->outs })
+            {
+                for (auto& s: *list)
+                {
+                    slots.insert(&s);
+                    for (auto src: s.sources)
+                        src->consumers--;
+                }
+            }
+            if (auto group = dynamic_cast<Group*>(m))
+                for (auto& sub: group->modules)
+                    self(self, sub.get());
+        };
+        collect(collect, removed.get());
+
+        // Wires leaving it, into the remaining children or the group's outputs
+        auto unwire = [&](Slot& s)
+        {
+            std::erase_if(s.sources, [&](const Slot* src) { return slots.contains(src); });
+        };
+        auto walk = [&](auto&& self, Module* m) -> void
+        {
+            for (auto& s: m->ins)
+                unwire(s);
+            if (auto group = dynamic_cast<Group*>(m))
+            {
+                for (auto& s: group->outs)
+                    unwire(s);
+                for (auto& sub: group->modules)
+                    self(self, sub.get());
+            }
+        };
+        walk(walk, this);
+
+        Slot::revision++;
+        layout++;
+        return removed;
+    }
+
+    void Group::index()
+    {
+        paths.clear();
+        std::string path;
+        auto visit = [&](auto&& self, Module& m) -> void
+        {
+            const size_t length = path.size();
+            auto entry = [&](const std::string& name) -> Handle&
+            {
+                path.resize(length);
+                path += name;
+                return paths[path];
+            };
+            for (auto& s: m.ins)
+                entry(s.name).input = &s;
+            for (auto& s: m.outs)
+                entry(s.name).output = &s;
+            for (auto& p: m.parameters)
+                entry(p.name).parameter = &p;
+            if (auto group = dynamic_cast<Group*>(&m))
+            {
+                for (auto& sub: group->modules)
+                {
+                    entry(sub->name).module = sub.get();
+                    path += '.';
+                    self(self, *sub);
+                }
+            }
+            path.resize(length);
+        };
+        visit(visit, *this);
+        indexed = layout;
+    }
+
+    Handle Group::resolve(std::string_view path)
+    {
+        if (indexed != layout)
+            index();
+        auto it = paths.find(path);
+        return it != paths.end() ? it->second : Handle {};
+    }
+
+    void Group::resolve(std::span<const std::string_view> paths, std::span<Handle> handles)
+    {
+        if (indexed != layout)
+            index();
+        for (size_t i = 0; i < paths.size() && i < handles.size(); i++)
+        {
+            auto it = this->paths.find(paths[i]);
+            handles[i] = it != this->paths.end() ? it->second : Handle {};
+        }
+    }
+
+    // On a miss, the path may still lead inside a module that is not a group and keeps
+    // its children to itself: returns that module and the rest of the path
+    std::pair<Module*, std::string_view> Group::opaque(std::string_view path) const
+    {
+        for (auto dotpos = path.rfind('.'); dotpos != std::string_view::npos && dotpos > 0; dotpos = path.rfind('.', dotpos - 1))
+        {
+            auto it = paths.find(path.substr(0, dotpos));
+            if (it == paths.end() || !it->second.module)
+                continue;
+            if (dynamic_cast<Group*>(it->second.module))
+                break;
+            return { it->second.module, path.substr(dotpos + 1) };
+        }
+        return { nullptr, {} };
+    }
+
+    Parameter* Group::findParameter(std::string_view path)
+    {
+        if (auto handle = resolve(path); handle.parameter)
+            return handle.parameter;
+        auto [module, rest] = opaque(path);
+        return module ? module->findParameter(rest) : nullptr;
+    }
+
+    Slot* Group::findInput(std::string_view path)
+    {
+        if (auto handle = resolve(path); handle.input)
+            return handle.input;
+        auto [module, rest] = opaque(path);
+        return module ? module->findInput(rest) : nullptr;
+    }
+
+    Slot* Group::findOutput(std::string_view path)
+    {
+        if (auto handle = resolve(path); handle.output)
+            return handle.output;
+        auto [module, rest] = opaque(path);
+        return module ? module->findOutput(rest) : nullptr;
+    }
+
+    Module* Group::findModule(std::string_view path)
+    {
+        if (auto handle = resolve(path); handle.module)
+            return handle.module;
+        auto [module, rest] = opaque(path);
+        return module ? module->findModule(rest) : nullptr;
+    }
+
+    Group::Plan Group::compilePlan()
+    {
+        Plan result;
+        result.revision = Slot::revision;
+
+        // Every slot reachable inside a child (including nested groups) belongs to that child
+        const size_t count = modules.size();
+        std::unordered_map<const Slot*, size_t> owners;
+        auto addOwner = [&](auto&& self, Module* m, size_t index) -> void
+        {
+            for (auto& s: m->ins)
+                owners[&s] = index;
+            for (auto& s: m->outs)
+                owners[&s] = index;
+            if (auto group = dynamic_cast<Group*>(m))
+                for (auto& sub: group->modules)
+                    self(self, sub.get(), index);
+        };
+        for (size_t i = 0; i < count; i++)
+            addOwner(addOwner, modules[i].get(), i);
+
+        auto forInputs = [&](auto&& self, Module* m, auto&& func) -> void
+        {
+            for (auto& s: m->ins)
+                func(s);
+            if (auto group = dynamic_cast<Group*>(m))
+                for (auto& sub: group->modules)
+                    self(self, sub.get(), func);
+        };
+
+        std::vector<std::vector<size_t>> successors(count);
+        std::vector<int> indegree(count, 0);
+        for (size_t j = 0; j < count; j++)
+        {
+            forInputs(forInputs, modules[j].get(), [&](Slot& s)
+            {
+                for (auto src: s.sources)
+                {
+                    auto it = owners.find(src);
+                    if (it == owners.end() || it->second == j)
+                        continue;
+                    successors[it->second].push_back(j);
+                    indegree[j]++;
+                }
+            });
+        }
+
+        // Kahn's algorithm, ties broken by insertion order. When only cycles remain the
+        // earliest pending module is released and its incoming wires get a delay line.
+        static constexpr size_t unscheduled = size_t(-1);
+        std::vector<size_t> position(count, unscheduled);
+        std::vector<bool> scheduled(count, false);
+        std::vector<size_t> order;
+        order.reserve(count);
+        std::priority_queue<size_t, std::vector<size_t>, std::greater<size_t>> ready;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (indegree[i] == 0)
+            {
+                scheduled[i] = true;
+                ready.push(i);
+            }
+        }
+
+        size_t pending = 0;
+        while (order.size() < count)
+        {
+            if (ready.empty())
+            {
+                while (scheduled[pending])
+                    pending++;
+                scheduled[pending] = true;
+                ready.push(pending);
+            }
+
+            size_t i = ready.top();
+            ready.pop();
+            position[i] = order.size();
+            order.push_back(i);
+            for (auto j: successors[i])
+            {
+                if (--indegree[j] == 0 && !scheduled[j])
+                {
+                    scheduled[j] = true;
+                    ready.push(j);
+                }
+            }
+        }
+
+        auto isFeedback = [&](const Slot* src, size_t consumer)
+        {
+            auto it = owners.find(src);
+            return it != owners.end() && position[it->second] >= position[consumer];
+        };
+
+        // Partitions are chains of modules that run concurrently with the other partitions of
+        // their wave. A module joins its predecessors' partition when it is their only consumer,
+        // otherwise it starts a new one in the wave after its latest predecessor. Feedback wires
+        // read delay lines and do not order anything within a block.
+        std::vector<std::vector<size_t>> predecessors(count);
+        std::vector<std::vector<size_t>> consumers(count);
+        for (size_t j = 0; j < count; j++)
+        {
+            forInputs(forInputs, modules[j].get(), [&](Slot& s)
+            {
+                for (auto src: s.sources)
+                {
+                    auto it = owners.find(src);
+                    if (it == owners.end() || it->second == j || isFeedback(src, j))
+                        continue;
+                    predecessors[j].push_back(it->second);
+                    consumers[it->second].push_back(j);
+                }
+            });
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            for (auto list: { &predecessors[i], &consumers[i] })
+            {
+                std::sort(list->begin(), list->end());
+                list->erase(std::unique(list->begin(), list->end()), list->end());
+            }
+        }
+
+        std::vector<size_t> partition(count);
+        std::vector<uint32_t> waves;
+        for (auto i: order)
+        {
+            const auto& pred = predecessors[i];
+            const bool chained = !pred.empty() && std::all_of(pred.begin(), pred.end(), [&](size_t p)
+            {
+                return partition[p] == partition[pred.front()] && consumers[p].size() == 1;
+            });
+            if (chained)
+            {
+                partition[i] = partition[pred.front()];
+                continue;
+            }
+
+            uint32_t wave = 0;
+            for (auto p: pred)
+                wave = std::max(wave, waves[partition[p]] + 1);
+            partition[i] = waves.size();
+            waves.push_back(wave);
+        }
+
+        // Steps follow the partitions wave by wave, which stays topological
+        std::vector<size_t> steps = order;
+        std::stable_sort(steps.begin(), steps.end(), [&](size_t a, size_t b)
+        {
+            return std::pair(waves[partition[a]], partition[a]) < std::pair(waves[partition[b]], partition[b]);
+        });
+
+        // Delay lines first so inputs can reference them
+        std::unordered_map<const Slot*, size_t> delays;
+        for (auto i: order)
+        {
+            for (auto& s: modules[i]->ins)
+            {
+                for (auto src: s.sources)
+                {
+                    if (isFeedback(src, i) && !delays.contains(src))
+                    {
+                        delays[src] = result.delays.size();
+                        result.delays.push_back({ .source = src, .line = Slot::create("delay") });
+                    }
+                }
+            }
+        }
+        for (auto& delay: result.delays)
+        {
+            delay.line->buffer.assign(blocksize, 0.f);
+            delay.line->data = delay.line->buffer.data();
+        }
+
+        auto addInput = [&](std::vector<Plan::Input>& inputs, Slot& s, size_t consumer)
+        {
+            Plan::Input input = {
+                .slot = &s,
+                .sources = uint32_t(result.sources.size()),
+                .count = uint32_t(s.sources.size())
+            };
+            for (auto src: s.sources)
+            {
+                if (consumer != unscheduled && isFeedback(src, consumer))
+                    result.sources.push_back(result.delays[delays[src]].line.get());
+                else
+                    result.sources.push_back(src);
+            }
+            inputs.push_back(input);
+        };
+
+        auto weight = [&](auto&& self, const Module* m) -> uint32_t
+        {
+            uint32_t result = 1;
+            if (auto group = dynamic_cast<const Group*>(m))
+                for (const auto& sub: group->modules)
+                    result += self(self, sub.get());
+            return result;
+        };
+
+        size_t current = unscheduled;
+        for (auto i: steps)
+        {
+            auto& m = modules[i];
+            if (partition[i] != current)
+            {
+                current = partition[i];
+                result.partitions.push_back({
+                    .first = uint32_t(result.steps.size()),
+                    .count = 0,
+                    .weight = 0,
+                    .wave = waves[current]
+                });
+            }
+            result.partitions.back().count++;
+            result.partitions.back().weight += weight(weight, m.get());
+
+            Plan::Step step = {
+                .module = m.get(),
+                .inputs = uint32_t(result.inputs.size()),
+                .inputcount = 0
+            };
+            for (auto& s: m->ins)
+                addInput(result.inputs, s, i);
+            step.inputcount = uint32_t(result.inputs.size()) - step.inputs;
+            result.steps.push_back(step);
+        }
+
+        for (auto& sg: outs)
+            addInput(result.outputs, sg, unscheduled);
+
+        // Heaviest first within a wave so the scheduler hands them out before the small ones
+        std::stable_sort(result.partitions.begin(), result.partitions.end(), [](const auto& a, const auto& b)
+        {
+            return a.wave != b.wave ? a.wave < b.wave : a.weight > b.weight;
+        });
+        for (uint32_t p = 0; p < result.partitions.size(); p++)
+            if (p == 0 || result.partitions[p].wave != result.partitions[p - 1].wave)
+                result.waves.push_back(p);
+        result.waves.push_back(uint32_t(result.partitions.size()));
+        result.tasks.resize(result.partitions.size());
+
+        return result;
+    }
 }
\ No newline at end of file
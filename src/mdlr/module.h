@@ -6,11 +6,18 @@
 #include <functional>
 #include <variant>
 #include <span>
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <limits>
+#include <unordered_map>
 
 #define FMT_CONSTEVAL
 #include <fmt/format.h>
 
 #include "mdlr/util.h"
+#include "mdlr/memory.h"
+#include "mdlr/profiler.h"
 
 namespace mdlr
 {
@@ -18,17 +25,100 @@ namespace mdlr
     
     struct Module;
 
+    // How often a slot's value changes.
+    // - audio: a value per frame.
+    // - control: one value per block (or sub-block), kept in `signal`. Inputs take their
+    //   sources' latest value at the block boundary and expose it as a constant block, or as
+    //   a ramp from the previous value when `interpolate` is set.
+    // - event: piecewise constant but sample accurate (gates, clocks, notes), resolved like
+    //   audio slots.
+    enum class Rate: uint8_t
+    {
+        audio,
+        control,
+        event,
+    };
+
     struct Slot
     {
         std::string name;
-        std::vector<Slot*> targets;
+        std::vector<Slot*> sources;
         Signal signal = 0.f;
+        std::vector<Signal> buffer;
+        const Signal* data = nullptr;
+        int consumers = 0;
+        Rate rate = Rate::audio;
+        bool interpolate = false;
+        bool constant = false;      // data holds one value for the whole block, read data[0]
+
+        // Bumped on every graph edit, groups that are not live recompile their plan when it changes
+        static inline std::atomic<uint64_t> revision = 1;
+
+        // Wires are pulled: the target keeps a list of its sources
+        void connect(Slot& other) { other.sources.push_back(this); consumers++; revision++; }
+        void disconnect(Slot& other)
+        {
+            auto count = other.sources.size();
+            other.sources.erase(std::remove(other.sources.begin(), other.sources.end(), this), other.sources.end());
+            consumers -= int(count - other.sources.size());
+            revision++;
+        }
+
+        void pull()
+        {
+            if (sources.empty())
+                return;
+            signal = 0.f;
+            for (auto s: sources)
+                signal += s->signal;
+        }
+
+        void fill(int frames) { std::fill_n(buffer.data(), frames, signal); }
+
+        // Unconnected slots expose their signal as a constant block, refilled only when it changes
+        void hold()
+        {
+            if (!buffer.empty() && buffer.front() != signal)
+                std::fill(buffer.begin(), buffer.end(), signal);
+            data = buffer.data();
+            constant = true;
+        }
+
+        // Control-rate update: a constant block, or a ramp to the new value when interpolated
+        void settle(Signal value, int frames)
+        {
+            if (!interpolate || value == signal)
+            {
+                signal = value;
+                hold();
+                return;
+            }
+
+            const Signal step = (value - signal) / Signal(frames);
+            for (int f = 0; f < frames; f++)
+                buffer[f] = signal + step * Signal(f + 1);
+            std::fill(buffer.begin() + frames, buffer.end(), value);
+            signal = value;
+            data = buffer.data();
+            constant = false;
+        }
 
-        void connect(Slot& other) { targets.push_back(&other); }
-        void disconnect(Slot& other) { targets.erase(std::remove(targets.begin(), targets.end(), &other), targets.end()); }
-        void propagate() { for (auto& t: targets) t->signal = signal; }
+        // The value a control-rate consumer samples at the end of a block
+        Signal latest(int frames) const { return rate == Rate::control ? signal : data[frames - 1]; }
 
-        Slot& operator=(const Slot&) = default;
+        Slot& operator=(const Slot& other)
+        {
+            name = other.name;
+            sources = other.sources;
+            signal = other.signal;
+            buffer = other.buffer;
+            data = buffer.data();
+            consumers = other.consumers;
+            rate = other.rate;
+            interpolate = other.interpolate;
+            constant = other.constant;
+            return *this;
+        }
         Slot& operator=(const Signal& sig) { signal = sig; return *this; }
         operator Signal() const { return signal; }
 
@@ -39,6 +129,8 @@ namespace mdlr
     };
 
     struct Module;
+    struct Scheduler;
+    struct Plans;
 
     using ParameterValue
         = std::variant<
@@ -50,35 +142,136 @@ namespace mdlr
             , std::span<uint8_t>
         >;
 
+    // A typed value owned by its module, so reading it costs no call. Bools, ints and floats
+    // live in an atomic word any thread may read with get<T>(). Strings and blobs are replaced
+    // by swapping in the caller's buffer, by the thread running the module only: the previous
+    // value goes back in the ParameterValue and is freed by the caller (see Engine::setParameter).
+    // Each change bumps a counter modules can poll to rebuild state derived from the value.
     struct Parameter
     {
-        using Setter = std::function<void(Module*, ParameterValue&&)>;
-        using Getter = std::function<ParameterValue(Module*)>;
-
-        Module* parent;
+        Module* parent = nullptr;
         std::string name;
-        Setter setter;
-        Getter getter;
+        uint8_t type = 0;           // index of the value's alternative in ParameterValue
+        bool staged = false;        // changes need the module's prepareParameter(), see staging()
 
         Parameter() = default;
-        Parameter(Module* parent, std::string_view name, Setter&& setter, Getter&& getter)
+        Parameter(Module* parent, std::string_view name, ParameterValue&& value)
             : parent(parent)
-            , name(name.data())
-            , setter(setter)
-            , getter(getter)
-        {}
-
-        template <typename Class, std::convertible_to<ParameterValue> MemberType>
-        Parameter(Module* parent, std::string_view name, MemberType Class::*member)
-            : Parameter(
-                  parent
-                , name
-                , [&](Module* m, ParameterValue&& v) { (*(Class*) m).*member = std::get<MemberType>(v); }
-                , [&](Module* m) { return ParameterValue((*(Class*) m).*member); })
-        {}
-
-        Parameter& operator=(ParameterValue&& v) { setter(parent, std::move(v)); return *this; }
-        operator ParameterValue() const { return getter(parent); }
+            , name(name)
+            , type(uint8_t(value.index()))
+        {
+            set(std::move(value));
+            changes.store(0, std::memory_order_relaxed);
+        }
+
+        // Moved while modules build their parameter list only
+        Parameter(Parameter&& other) { *this = std::move(other); }
+        Parameter& operator=(Parameter&& other)
+        {
+            parent = other.parent;
+            name = std::move(other.name);
+            type = other.type;
+            staged = other.staged;
+            word.store(other.word.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            changes.store(other.changes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            min = other.min;
+            max = other.max;
+            text = std::move(other.text);
+            blob = other.blob;
+            return *this;
+        }
+
+        template <typename T> requires std::same_as<T, bool> || std::same_as<T, int> || std::same_as<T, float>
+        T get() const
+        {
+            const uint32_t bits = word.load(std::memory_order_relaxed);
+            if constexpr (std::same_as<T, bool>)
+                return bits != 0;
+            else
+                return std::bit_cast<T>(bits);
+        }
+        const std::string& string() const { return text; }
+        std::span<uint8_t> bytes() const { return blob; }
+
+        // Ints and floats are clamped to the range
+        Parameter& range(double min, double max)
+        {
+            this->min = min;
+            this->max = max;
+            return *this;
+        }
+
+        // For modules deriving state from the value in prepareParameter()/applyParameter(): the
+        // parameter then only changes through them, never by a bare set() (e.g. from automation)
+        Parameter& staging()
+        {
+            staged = true;
+            return *this;
+        }
+
+        // Refuses values of another type
+        bool set(ParameterValue&& value)
+        {
+            if (value.index() != type)
+                return false;
+            if (auto b = std::get_if<bool>(&value))
+                word.store(*b ? 1 : 0, std::memory_order_relaxed);
+            else if (auto i = std::get_if<int>(&value))
+                word.store(std::bit_cast<uint32_t>(int(std::clamp<double>(*i, min, max))), std::memory_order_relaxed);
+            else if (auto f = std::get_if<float>(&value))
+                word.store(std::bit_cast<uint32_t>(float(std::clamp<double>(*f, min, max))), std::memory_order_relaxed);
+            else if (auto s = std::get_if<std::string>(&value))
+                std::swap(text, *s);
+            else if (auto b = std::get_if<std::span<uint8_t>>(&value))
+                blob = *b;
+            changes.fetch_add(1, std::memory_order_release);
+            return true;
+        }
+
+        // Counts the changes since construction, `seen` keeps the last count acted on
+        uint32_t revision() const { return changes.load(std::memory_order_acquire); }
+        bool changed(uint32_t& seen) const
+        {
+            const uint32_t current = revision();
+            if (current == seen)
+                return false;
+            seen = current;
+            return true;
+        }
+
+        Parameter& operator=(ParameterValue&& v) { set(std::move(v)); return *this; }
+        operator ParameterValue() const
+        {
+            switch (type)
+            {
+                case 1: return get<bool>();
+                case 2: return get<int>();
+                case 3: return get<float>();
+                case 4: return text;
+                case 5: return blob;
+                default: return {};
+            }
+        }
+
+    private:
+        std::atomic<uint32_t> word = 0;
+        std::atomic<uint32_t> changes = 0;
+        double min = -std::numeric_limits<double>::infinity();
+        double max = std::numeric_limits<double>::infinity();
+        std::string text;
+        std::span<uint8_t> blob;
+    };
+
+    // Where the audio thread is in time, published by the engine before each period and
+    // sub-block. Modules replaying timestamped events (MIDI) place them against it rather than
+    // against the wall clock at the time they run. All zero when no engine drives the graph.
+    struct FrameClock
+    {
+        int64_t previous = 0;       // steady_clock ns at which the previous period started
+        int64_t period = 0;         // steady_clock ns at which the current period started
+        uint64_t start = 0;         // engine frame of the current period
+        uint64_t frame = 0;         // engine frame of the current sub-block
+        int frames = 0;             // length of the current period
     };
 
     struct Module
@@ -87,21 +280,32 @@ namespace mdlr
         stable_vector<Slot> ins;
         stable_vector<Slot> outs;
         stable_vector<Parameter> parameters;
+        int blocksize = 0;
+
+        // Bumped when modules, slots or parameters are added or removed, groups rebuild
+        // their path index when it changes
+        static inline std::atomic<uint64_t> layout = 1;
+
+        // Audio thread only
+        static inline FrameClock clock;
+    #if defined(MDLR_PROFILE)
+        ProfileCounter profile;
+    #endif
 
         virtual ~Module() = default;
         virtual void process(float samplerate) = 0;
 
+        // Processes a whole block of frames, reading and writing the slot buffers.
+        // The default implementation runs the per-sample process() for legacy modules.
+        virtual void processBlock(float samplerate, int frames);
+        virtual void prepare(int blocksize);
+
         Slot& addInput(std::string_view name, float defaultValue = 0.f);
         void addInputs(std::string_view basename, int count, float defaultValue = 0.f);
         Slot& addOutput(std::string_view name, float defaultValue = 0.f);
         void addOutputs(std::string_view basename, int count, float defaultValue = 0.f);
-        Parameter& addParameter(std::string_view name, Parameter::Setter&& setter, Parameter::Getter&& getter);
-
-        template <typename Class, std::convertible_to<ParameterValue> MemberType>
-        Parameter& addParameter(std::string_view name, MemberType Class::*member)
-        {
-            return parameters.emplace_back(Parameter(this, name, member));
-        }
+        // The initial value sets the parameter's type
+        Parameter& addParameter(std::string_view name, ParameterValue value);
 
         virtual Parameter* findParameter(std::string_view path);
         virtual Slot* findInput(std::string_view path);
@@ -110,6 +314,36 @@ namespace mdlr
         
         virtual std::string string() const;
         virtual void randomize(int mode=0) {}
+
+        // Compiles the groups below this module for Engine::commit, nested ones first. Modules
+        // owning groups outside of a group's module list (voices, oversampled groups) forward it.
+        virtual void compileTree(Plans& plans) {}
+
+        // Parameter changes are split in two: prepareParameter() runs on the control thread and
+        // may allocate into the payload, applyParameter() runs on the audio thread and must not.
+        // Parameters whose changes need both are marked with Parameter::staging().
+        virtual void prepareParameter(Parameter& parameter, const ParameterValue& value, Memory& payload) {}
+        virtual void applyParameter(Parameter& parameter, ParameterValue&& value, Memory& payload) { parameter.set(std::move(value)); }
+
+        // Both halves on the calling thread, for modules that are not running
+        void setParameter(Parameter& parameter, ParameterValue value)
+        {
+            Memory payload;
+            prepareParameter(parameter, value, payload);
+            applyParameter(parameter, std::move(value), payload);
+        }
+    };
+
+    // What a dotted path leads to. An input and an output (or a parameter) may share a
+    // name, each gets its own field. Pointers stay valid until their module is removed.
+    struct Handle
+    {
+        Module* module = nullptr;
+        Slot* input = nullptr;
+        Slot* output = nullptr;
+        Parameter* parameter = nullptr;
+
+        explicit operator bool() const { return module || input || output || parameter; }
     };
 
     struct Group: Module
@@ -118,43 +352,196 @@ namespace mdlr
 
         virtual void process(float samplerate) override
         {
-            for (auto& sg: ins)
-                sg.propagate();
-
             for (auto& m: modules)
             {
+                for (auto& s: m->ins)
+                    s.pull();
                 m->process(samplerate);
-                for (auto& s: m->outs)
-                    s.propagate();
             }
 
             for (auto& sg: outs)
-                sg.propagate();
+                sg.pull();
         }
 
-        template <typename Mod, typename ... Args>
-        Mod& create(std::string_view name, Args&& ... args)
+        // Flattened execution list: modules in topological order, each preceded by the
+        // resolution of its inputs. Inputs read their single source in place and only
+        // inputs with several sources get mixed into their own buffer.
+        struct Plan
         {
-            auto& mod = modules.emplace_back(std::make_unique<Mod>(std::forward<Args>(args)...));
-            mod->name = name;
-            return *(Mod*) mod.get();
+            struct Input
+            {
+                Slot* slot;
+                uint32_t sources;
+                uint32_t count;
+            };
+
+            struct Step
+            {
+                Module* module;
+                uint32_t inputs;
+                uint32_t inputcount;
+            };
+
+            // One-block delay line closing a feedback cycle. The line is held by pointer so plans
+            // move without copying slots and inputs can reference it as soon as it exists.
+            struct Delay
+            {
+                const Slot* source;
+                std::unique_ptr<Slot> line;
+            };
+
+            // Contiguous range of steps, independent from the other partitions of its wave
+            struct Partition
+            {
+                uint32_t first;
+                uint32_t count;
+                uint32_t weight;
+                uint32_t wave;
+            };
+
+            std::vector<Step> steps;
+            std::vector<Partition> partitions;
+            std::vector<uint32_t> waves;        // first partition of each wave, then the end
+            std::vector<uint32_t> tasks;        // scheduler scratch, one entry per partition
+            std::vector<Input> inputs;
+            std::vector<Input> outputs;
+            std::vector<const Slot*> sources;
+            std::vector<Delay> delays;
+            uint64_t revision = 0;
+            bool live = false;                  // compiled by compileTree() for Engine::commit
+
+            void resolve(const Input& input, int frames) const
+            {
+                auto slot = input.slot;
+                if (input.count == 0)
+                {
+                    slot->hold();
+                    return;
+                }
+
+                const Slot* const* from = sources.data() + input.sources;
+                if (slot->rate == Rate::control)
+                {
+                    Signal value = 0.f;
+                    for (uint32_t i = 0; i < input.count; i++)
+                        value += from[i]->latest(frames);
+                    slot->settle(value, frames);
+                    return;
+                }
+
+                slot->constant = false;
+                if (input.count == 1)
+                {
+                    slot->data = from[0]->data;
+                    return;
+                }
+
+                Signal* mix = slot->buffer.data();
+                std::copy_n(from[0]->data, frames, mix);
+                for (uint32_t i = 1; i < input.count; i++)
+                {
+                    const Signal* other = from[i]->data;
+                    for (int f = 0; f < frames; f++)
+                        mix[f] += other[f];
+                }
+                slot->data = mix;
+            }
+        };
+
+        Plan plan;
+
+        // When set, partitions are spread over the scheduler's worker threads
+        Scheduler* scheduler = nullptr;
+
+        // A group running a live plan is on the audio thread while the control thread edits it,
+        // so it never recompiles on its own: edits take effect when a plan compiled off the audio
+        // thread is swapped in (see Engine::commit). Other groups recompile lazily after an edit.
+        Plan compilePlan();
+        void compile() { Plan next = compilePlan(); swap(next); }
+
+        // Compiles this group and the groups nested in it, children first, into live plans
+        virtual void compileTree(Plans& plans) override;
+
+        // Makes `next` the running plan and leaves the previous one in it. Unconnected inputs
+        // are refilled, delay lines that survive the edit keep their contents.
+        void swap(Plan& next);
+
+        void runSteps(uint32_t first, uint32_t count, float samplerate, int frames)
+        {
+            for (uint32_t s = first; s < first + count; s++)
+            {
+                const auto& step = plan.steps[s];
+                for (uint32_t i = step.inputs; i < step.inputs + step.inputcount; i++)
+                    plan.resolve(plan.inputs[i], frames);
+                MDLR_PROFILE_SCOPE(step.module->profile, frames);
+                step.module->processBlock(samplerate, frames);
+            }
         }
 
-        virtual Module* findModule(std::string_view path) override
+        virtual void processBlock(float samplerate, int frames) override;
+
+        virtual void prepare(int blocksize) override
         {
-            auto dotpos = path.find(".");
-            auto stub = path.substr(0, dotpos);
-            auto ext = path.substr(dotpos + 1);
+            Module::prepare(blocksize);
             for (auto& m: modules)
+                m->prepare(blocksize);
+        }
+
+        Module& add(std::string_view name, std::unique_ptr<Module> module)
+        {
+            auto& mod = modules.emplace_back(std::move(module));
+            mod->name = name;
+            Slot::revision++;
+            layout++;
+            if (blocksize > 0)
+                mod->prepare(blocksize);
+            return *mod;
+        }
+
+        // Takes a child out of the graph along with its wires. The module is handed back
+        // because a running plan may still reference it, see Engine::commit.
+        std::unique_ptr<Module> remove(Module& module);
+
+        // Takes every child out along with the wires of the group's own slots
+        std::vector<std::unique_ptr<Module>> clear()
+        {
+            auto removed = std::move(modules);
+            modules.clear();
+            for (auto& s: ins)
             {
-                if (m->name == stub)
-                    return dotpos == std::string_view::npos
-                        ? m.get()
-                        : m->findModule(ext);
+                s.sources.clear();
+                s.consumers = 0;
             }
-            return nullptr;
+            for (auto& s: outs)
+            {
+                s.sources.clear();
+                s.consumers = 0;
+            }
+            Slot::revision++;
+            layout++;
+            return removed;
+        }
+
+        template <typename Mod, typename ... Args>
+        Mod& create(std::string_view name, Args&& ... args)
+        {
+            return (Mod&) add(name, std::make_unique<Mod>(std::forward<Args>(args)...));
         }
 
+        // Every path below the group, hashed in full ("acid.seq.clock") so a lookup costs one
+        // hash of the path instead of name comparisons at each level. Rebuilt by the first
+        // lookup after a layout change. Modules keeping their children to themselves (voices,
+        // oversampled groups) are searched through their own find functions on a miss.
+        Handle resolve(std::string_view path);
+
+        // Resolves many paths against one build of the index, unknown paths give an empty handle
+        void resolve(std::span<const std::string_view> paths, std::span<Handle> handles);
+
+        virtual Parameter* findParameter(std::string_view path) override;
+        virtual Slot* findInput(std::string_view path) override;
+        virtual Slot* findOutput(std::string_view path) override;
+        virtual Module* findModule(std::string_view path) override;
+
         virtual std::string string() const override
         {
             std::string result = Module::string();
@@ -171,5 +558,21 @@ namespace mdlr
         }
 
         virtual void randomize(int mode=0) override { for (auto& m: modules) m->randomize(mode); }
+
+    private:
+        struct StringHash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+        };
+
+        std::unordered_map<std::string, Handle, StringHash, std::equal_to<>> paths;
+        uint64_t indexed = 0;
+
+        void index();
+        std::pair<Module*, std::string_view> opaque(std::string_view path) const;
     };
+
+    // Plans compiled for a tree of groups, nested groups first
+    struct Plans: std::vector<std::pair<Group*, Group::Plan>> {};
 }
\ No newline at end of file
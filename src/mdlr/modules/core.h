@@ -1,7 +1,11 @@
 #pragma once
 
 #include "mdlr/module.h"
+#include "mdlr/registry.h"
 #include "mdlr/util.h"
+#include "mdlr/simd.h"
+#include "mdlr/fastmath.h"
+#include "mdlr/smoothing.h"
 
 #include <cmath>
 
@@ -19,8 +23,8 @@ namespace mdlr
             slot_output,
         };
 
-        float gain = 1.f;
-        float offset = 0.f;
+        Smoother gain { 1.f };
+        Smoother offset { 0.f };
 
         Attenuator()
         {
@@ -36,11 +40,34 @@ namespace mdlr
 
         virtual void process(float samplerate) override
         {
-            const float lerpfac = 1000.f / samplerate;
-            gain = (1. - lerpfac) * gain + lerpfac * ins[slot_gain];
-            offset = (1. - lerpfac) * offset + lerpfac * ins[slot_offset];
+            gain.prepare(samplerate, 1000.f);
+            offset.prepare(samplerate, 1000.f);
+            outs[slot_output] = ins[slot_input] * gain.next(ins[slot_gain]) + offset.next(ins[slot_offset]);
+        }
+
+        virtual void processBlock(float samplerate, int frames) override
+        {
+            const Signal* input = ins[slot_input].data;
+            const Signal* gains = ins[slot_gain].data;
+            const Signal* offsets = ins[slot_offset].data;
+            Signal* output = outs[slot_output].buffer.data();
+
+            gain.prepare(samplerate, 1000.f);
+            offset.prepare(samplerate, 1000.f);
+
+            // Held controls that the smoothers have caught up with: a plain multiply-add
+            const bool held = ins[slot_gain].constant && ins[slot_offset].constant;
+            if (held && gain.settle(gains[0]) && offset.settle(offsets[0]))
+            {
+                const float g = gain;
+                const float o = offset;
+                for (int f = 0; f < frames; f++)
+                    output[f] = input[f] * g + o;
+                return;
+            }
 
-            outs[slot_output] = ins[slot_input] * gain + offset;
+            for (int f = 0; f < frames; f++)
+                output[f] = input[f] * gain.next(gains[f]) + offset.next(offsets[f]);
         }
     };
 
@@ -54,7 +81,9 @@ namespace mdlr
             slot_output,
         };
 
+        // Normalized, in [0, 1)
         float phase = 0.f;
+        Parameter* accuracy;
 
         Oscillator()
         {
@@ -64,12 +93,76 @@ namespace mdlr
             outs = {
                 { "output" }
             };
+            accuracy = &addParameter("accuracy", int(simd::Accuracy::normal)).range(0, 2);
         }
 
         virtual void process(float samplerate) override
         {
-            outs[slot_output] = std::sin(phase);
-            phase = fmod(phase + 2.f * M_PI * ins[slot_frequency] / samplerate, 2.f * M_PI);
+            outs[slot_output] = simd::sine(phase);
+            phase = simd::wrap(phase + ins[slot_frequency] / samplerate);
+        }
+
+        virtual void processBlock(float samplerate, int frames) override
+        {
+            const Signal* frequency = ins[slot_frequency].data;
+            Signal* output = outs[slot_output].buffer.data();
+            phase = render(phase, ins[slot_frequency].constant, frequency, output, samplerate, frames, simd::Accuracy(accuracy->get<int>()));
+        }
+
+        // Phases are laid out in the output first, then turned into a sine in place
+        static float render(float phase, bool constant, const Signal* frequency, Signal* output, float samplerate, int frames, simd::Accuracy accuracy)
+        {
+            const float invsr = 1.f / samplerate;
+            if (constant)
+                phase = simd::ramp(phase, frequency[0] * invsr, output, frames);
+            else
+            {
+                for (int f = 0; f < frames; f++)
+                    output[f] = frequency[f] * invsr;
+                phase = simd::ramp(phase, output, output, frames);
+            }
+            simd::sine(output, output, frames, accuracy);
+            return phase;
+        }
+    };
+
+    // Many sine oscillators in one module, input and output i drive oscillator i.
+    // With a single oscillator the slot layout is the same as Oscillator's.
+    struct OscillatorBank: Module
+    {
+        std::vector<float> phases;
+        Parameter* accuracy;
+
+        OscillatorBank(int count = 8)
+        {
+            addInputs("frequency", count, 120.f);
+            addOutputs("output", count);
+            phases.assign(count, 0.f);
+            accuracy = &addParameter("accuracy", int(simd::Accuracy::normal)).range(0, 2);
+        }
+
+        virtual void process(float samplerate) override
+        {
+            for (size_t i = 0; i < phases.size(); i++)
+            {
+                outs[i] = simd::sine(phases[i]);
+                phases[i] = simd::wrap(phases[i] + ins[i] / samplerate);
+            }
+        }
+
+        // Unconsumed outputs only advance their phase
+        virtual void processBlock(float samplerate, int frames) override
+        {
+            const auto mode = simd::Accuracy(accuracy->get<int>());
+            for (size_t i = 0; i < phases.size(); i++)
+            {
+                if (outs[i].consumers == 0 && ins[i].constant)
+                {
+                    phases[i] = simd::wrap(phases[i] + ins[i].signal * frames / samplerate);
+                    continue;
+                }
+                phases[i] = Oscillator::render(phases[i], ins[i].constant, ins[i].data, outs[i].buffer.data(), samplerate, frames, mode);
+            }
         }
     };
 
@@ -99,7 +192,20 @@ namespace mdlr
         {
             float x = ins[slot_input];
             float k = ins[slot_k];
-            outs[slot_output] = clamp(1.f / (1.f + exp(-k*x)), -1.f, 1.f);
+            outs[slot_output] = clamp(1.f / (1.f + fastmath::exp(-k*x)), -1.f, 1.f);
+        }
+
+        virtual void processBlock(float samplerate, int frames) override
+        {
+            const Signal* input = ins[slot_input].data;
+            const Signal* k = ins[slot_k].data;
+            Signal* output = outs[slot_output].buffer.data();
+
+            for (int f = 0; f < frames; f++)
+                output[f] = -k[f] * input[f];
+            fastmath::exp({ output, size_t(frames) }, { output, size_t(frames) });
+            for (int f = 0; f < frames; f++)
+                output[f] = clamp(1.f / (1.f + output[f]), -1.f, 1.f);
         }
     };
 
@@ -125,16 +231,16 @@ namespace mdlr
         ClockDivider()
         {
             ins = {
-                { "clock" }
+                { "clock", .rate = Rate::event }
             };
             outs = {
-                { "1/2" },
-                { "1/3" },
-                { "1/4" },
-                { "1/6" },
-                { "1/8" },
-                { "1/12" },
-                { "1/16" },
+                { "1/2", .rate = Rate::event },
+                { "1/3", .rate = Rate::event },
+                { "1/4", .rate = Rate::event },
+                { "1/6", .rate = Rate::event },
+                { "1/8", .rate = Rate::event },
+                { "1/12", .rate = Rate::event },
+                { "1/16", .rate = Rate::event },
             };
 
             for (int i = slot_1_2; i <= slot_1_16; i++)
@@ -198,14 +304,14 @@ namespace mdlr
                 { "in6" },
                 { "in7" },
 
-                { "volume0" },
-                { "volume1" },
-                { "volume2" },
-                { "volume3" },
-                { "volume4" },
-                { "volume5" },
-                { "volume6" },
-                { "volume7" },
+                { "volume0", .rate = Rate::control, .interpolate = true },
+                { "volume1", .rate = Rate::control, .interpolate = true },
+                { "volume2", .rate = Rate::control, .interpolate = true },
+                { "volume3", .rate = Rate::control, .interpolate = true },
+                { "volume4", .rate = Rate::control, .interpolate = true },
+                { "volume5", .rate = Rate::control, .interpolate = true },
+                { "volume6", .rate = Rate::control, .interpolate = true },
+                { "volume7", .rate = Rate::control, .interpolate = true },
             };
             outs = {
                 { "output" }
@@ -220,5 +326,29 @@ namespace mdlr
 
             outs[slot_output] = clamp(sum, -1.f, 1.f);
         }
+
+        virtual void processBlock(float, int frames) override
+        {
+            Signal* output = outs[slot_output].buffer.data();
+            std::fill_n(output, frames, 0.f);
+
+            for (int i = 0; i < 8; i++)
+            {
+                const Signal* input = ins[slot_in0 + i].data;
+                const Signal* volume = ins[slot_volume0 + i].data;
+                for (int f = 0; f < frames; f++)
+                    output[f] += input[f] * volume[f];
+            }
+
+            for (int f = 0; f < frames; f++)
+                output[f] = clamp(output[f], -1.f, 1.f);
+        }
     };
+
+    MDLR_REGISTER_MODULE(Attenuator);
+    MDLR_REGISTER_MODULE(Oscillator).range("frequency", 0.f, 24000.f);
+    MDLR_REGISTER_MODULE(OscillatorBank);
+    MDLR_REGISTER_MODULE(Sigmoid);
+    MDLR_REGISTER_MODULE(ClockDivider);
+    MDLR_REGISTER_MODULE(Mixer8);
 }
\ No newline at end of file
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "mdlr/module.h"
+#include "mdlr/registry.h"
+#include "mdlr/smoothing.h"
 
 namespace mdlr
 {
@@ -25,6 +27,8 @@ namespace mdlr
             release
         };
 
+        // a, d and r are per-sample steps, derived from the stage times only when they change
+        Coefficient attack, decay, release;
         float a, d, s, r;
         float value = 0.f;
         step step = step::attack;
@@ -32,11 +36,11 @@ namespace mdlr
         EnveloppeADSR()
         {
             ins = {
-                { "gate" },
-                { "a" },
-                { "d" },
-                { "s" },
-                { "r" },
+                { "gate", .rate = Rate::event },
+                { "a", .rate = Rate::control },
+                { "d", .rate = Rate::control },
+                { "s", .rate = Rate::control },
+                { "r", .rate = Rate::control },
             };
             outs = {
                 { "output" }
@@ -50,10 +54,10 @@ namespace mdlr
                 case step::attack:
                     {
                         if (gate)
-                            value += 1.f / (a * samplerate);
+                            value += a;
                         else
                         {
-                            value -= 1.f / (r * samplerate);
+                            value -= r;
                             step = step::release;
                         }
 
@@ -66,7 +70,7 @@ namespace mdlr
                     {
                         if (gate)
                         {
-                            value -= 1.f / (d * samplerate);
+                            value -= d;
                             if (value <= s)
                             {
                                 step = step::sustain;
@@ -74,7 +78,7 @@ namespace mdlr
                             }
                         } else
                         {
-                            value -= 1.f / (r * samplerate);
+                            value -= r;
                             step = step::release;
                         }
 
@@ -87,7 +91,7 @@ namespace mdlr
                     {
                         if (!gate)
                         {
-                            value -= 1.f / (r * samplerate);
+                            value -= r;
                             step = step::release;
                         }
                     }
@@ -98,9 +102,9 @@ namespace mdlr
                         if (gate)
                         {
                             step = step::attack;
-                            value += 1.f / (a * samplerate);
+                            value += a;
                         } else
-                            value -= 1.f / (r * samplerate);
+                            value -= r;
                     }
                     break;
             }
@@ -109,13 +113,37 @@ namespace mdlr
             return value;
         }
 
+        // Stage times in seconds to per-sample steps
+        void update(float at, float dt, float st, float rt, float samplerate)
+        {
+            auto increment = [](float time, float sr) { return 1.f / (clamp(time, 1.e-5f, 128.f) * sr); };
+            a = attack(at, samplerate, increment);
+            d = decay(dt, samplerate, increment);
+            r = release(rt, samplerate, increment);
+            s = clamp(st, 0.f, 1.f);
+        }
+
         virtual void process(float samplerate) override
         {
-            a = clamp(ins[slot_a], 1.e-5f, 128.f);
-            d = clamp(ins[slot_d], 1.e-5f, 128.f);
-            r = clamp(ins[slot_r], 1.e-5f, 128.f);
-            s = clamp(ins[slot_s], 0.f, 1.f);
+            update(ins[slot_a], ins[slot_d], ins[slot_s], ins[slot_r], samplerate);
             outs[slot_output] = process(ins[slot_gate] > 0.5f, samplerate);
         }
+
+        virtual void processBlock(float samplerate, int frames) override
+        {
+            const Signal* gate = ins[slot_gate].data;
+            Signal* output = outs[slot_output].buffer.data();
+
+            // Stage times are control rate, read once per block
+            update(ins[slot_a].signal, ins[slot_d].signal, ins[slot_s].signal, ins[slot_r].signal, samplerate);
+            for (int f = 0; f < frames; f++)
+                output[f] = process(gate[f] > 0.5f, samplerate);
+        }
     };
-}
\ No newline at end of file
+
+    MDLR_REGISTER_MODULE(EnveloppeADSR)
+        .range("a", 0.f, 60.f)
+        .range("d", 0.f, 60.f)
+        .range("s", 0.f, 1.f)
+        .range("r", 0.f, 60.f);
+}
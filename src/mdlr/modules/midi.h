@@ -1,27 +1,112 @@
 #pragma once
 
 #include "mdlr/module.h"
+#include "mdlr/registry.h"
+#include "mdlr/queue.h"
+#include "mdlr/log.h"
+#include "mdlr/fastmath.h"
 
 #include <libremidi/libremidi.hpp>
 #include <fmt/format.h>
 
+#include <bitset>
+#include <chrono>
+
 namespace mdlr
 {
+    struct MidiEvent
+    {
+        int64_t time = 0;
+        uint8_t bytes[3] = {};
+
+        libremidi::message_type type() const
+        {
+            return bytes[0] >= 0xF0
+                ? libremidi::message_type(bytes[0])
+                : libremidi::message_type(bytes[0] & 0xF0);
+        }
+        int channel() const { return (bytes[0] & 0x0F) + 1; }
+    };
+
+    // Events are stamped on arrival by the MIDI thread and replayed by the audio thread
+    // one period later, at the frame matching their arrival time. This keeps their relative
+    // timing at the cost of a constant one-period latency. Arrival times are placed against
+    // the engine's frame clock (Module::clock), so sub-blocks of a period each get their own
+    // events. Without an engine, each drain covers the wall time since the previous one.
+    struct MidiEventQueue
+    {
+        SpscQueue<MidiEvent> events { 1024 };
+        int64_t blocktime = 0;
+
+        static int64_t now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        // MIDI thread
+        void push(const libremidi::message& message)
+        {
+            MidiEvent event { .time = now() };
+            for (size_t i = 0; i < std::min<size_t>(message.size(), 3); i++)
+                event.bytes[i] = message[i];
+            events.push(std::move(event));
+        }
+
+        // Audio thread: calls func(offset, event) in order with increasing offsets in [0, frames)
+        template <typename Func>
+        void drain(float samplerate, int frames, Func&& func)
+        {
+            const auto& clock = Module::clock;
+            int64_t origin = clock.previous;
+            int64_t end = clock.period;
+            int skip = int(clock.frame - clock.start);
+            bool closing = clock.frame + frames >= clock.start + clock.frames;
+            if (clock.period == 0)
+            {
+                origin = blocktime;
+                end = blocktime = now();
+                skip = 0;
+                closing = true;
+            }
+
+            int last = 0;
+            while (MidiEvent* event = events.front())
+            {
+                if (event->time > end)
+                    break;
+
+                // Events for a later sub-block wait, the last one takes whatever is left
+                int offset = int(double(event->time - origin) * samplerate * 1.e-9) - skip;
+                if (offset >= frames && !closing)
+                    break;
+                offset = std::clamp(offset, last, frames - 1);
+                func(offset, *event);
+                last = offset;
+                events.pop();
+            }
+        }
+    };
+
     struct MidiCC128: Module
     {
         libremidi::midi_in midi;
+        MidiEventQueue queue;
         uint16_t channel_mask = 0xFFFF;
 
         MidiCC128()
         {
             outs.resize(128, {});
             for (int i = 0; i < 128; i++)
+            {
                 outs[i].name = fmt::format("cc.{}", i);
+                outs[i].rate = Rate::control;
+            }
 
-            midi.set_error_callback([](libremidi::midi_error type, std::string_view errorText) { fmt::println("Midi error: {}", errorText); });
+            midi.set_error_callback([](libremidi::midi_error type, std::string_view errorText) { trace(LogCategory::midi, "Midi error: {}", errorText); });
             midi.set_callback([&](const libremidi::message& message) { onMidiMessage(message); });
             midi.ignore_types(true, true, true);
-            
+
             int bspport = 0;
             for (int p = 0; p < midi.get_port_count(); p++)
             {
@@ -34,31 +119,49 @@ namespace mdlr
 
         virtual void process(float samplerate) override {}
 
+        // Control rate: the last value of each CC in the block, buffers are only refilled
+        // for outputs someone reads
+        virtual void processBlock(float samplerate, int frames) override
+        {
+            queue.drain(samplerate, frames, [&](int offset, const MidiEvent& event)
+            {
+                outs[event.bytes[1] & 0x7F].signal = float(event.bytes[2]) / 127.f;
+            });
+
+            for (auto& o: outs)
+                if (o.consumers > 0)
+                    o.hold();
+        }
+
         void onMidiMessage(const libremidi::message& message)
         {
             if (message.get_message_type() != libremidi::message_type::CONTROL_CHANGE)
                 return;
 
-            int channel = message.get_channel();
             uint8_t control = message.bytes[1];
             uint8_t value = message.bytes[2];
-            fmt::println("CC#{} => {}", control, value);
-            outs[control] = float(value) / 127.f;
+            trace(LogCategory::midi, "CC#{} => {}", control, value);
+            queue.push(message);
         }
     };
 
     struct MidiGate128: Module
     {
         libremidi::midi_in midi;
+        MidiEventQueue queue;
         int channel = -1;
+        std::bitset<128> partial;       // outputs whose buffer changed value within the block
 
         MidiGate128()
         {
             outs.resize(128, {});
             for (int i = 0; i < 128; i++)
+            {
                 outs[i].name = fmt::format("cc.{}", i);
+                outs[i].rate = Rate::event;
+            }
 
-            midi.set_error_callback([](libremidi::midi_error type, std::string_view errorText) { fmt::println("Midi error: {}", errorText); });
+            midi.set_error_callback([](libremidi::midi_error type, std::string_view errorText) { trace(LogCategory::midi, "Midi error: {}", errorText); });
             midi.set_callback([&](const libremidi::message& message) { onMidiMessage(message); });
             midi.ignore_types(true, true, true);
 
@@ -74,6 +177,36 @@ namespace mdlr
 
         virtual void process(float samplerate) override {}
 
+        // Outputs nobody reads are never written. An output that changed within the previous
+        // block is refilled whole, hold() alone would keep the partial run past its end.
+        virtual void processBlock(float samplerate, int frames) override
+        {
+            for (int i = 0; i < 128; i++)
+            {
+                auto& o = outs[i];
+                if (o.consumers == 0)
+                    continue;
+                if (partial[i])
+                    o.fill(int(o.buffer.size()));
+                o.hold();
+            }
+            partial.reset();
+
+            queue.drain(samplerate, frames, [&](int offset, const MidiEvent& event)
+            {
+                bool on = event.type() == libremidi::message_type::NOTE_ON && event.bytes[2] > 0;
+                const int note = event.bytes[1] & 0x7F;
+                auto& o = outs[note];
+                o.signal = on ? 1.f : 0.f;
+                if (o.consumers > 0)
+                {
+                    std::fill(o.buffer.begin() + offset, o.buffer.end(), o.signal);
+                    if (offset > 0)
+                        partial[note] = true;
+                }
+            });
+        }
+
         void onMidiMessage(const libremidi::message& message)
         {
             if (!message.is_note_on_or_off())
@@ -84,8 +217,8 @@ namespace mdlr
 
             bool on = message.get_message_type() == libremidi::message_type::NOTE_ON;
             uint8_t note = message.bytes[1];
-            fmt::println("Pad#{} => {}", note, on ? "ON" : "OFF");
-            outs[note] = on ? 1.f : 0.f;
+            trace(LogCategory::midi, "Pad#{} => {}", note, on ? "ON" : "OFF");
+            queue.push(message);
         }
     };
 
@@ -106,30 +239,31 @@ namespace mdlr
         };
 
         libremidi::midi_in midi;
+        MidiEventQueue queue;
         uint16_t channel_mask = 0xFFFF;
         uint8_t lastnote = 0;
 
-        struct {
-            bool clock = false;
-            bool start = false;
-            bool cont = false;
-            bool stop = false;
-        } transport;
+        // Note on/off messages are also forwarded to these, e.g. a PolyGroup's queue. Queues are
+        // single producer, so a queue is listed by one MidiIn at most.
+        std::vector<MidiEventQueue*> notes;
+
+        // Transport pulses that did not fit in the previous block
+        int pending[4] = {};
 
         MidiIn()
         {
             outs = {
-                { "pitch" },
-                { "gate" },
-                { "velocity" },
-                { "aftertouch" },
-                { "pitchbend" },
-                { "modulation" },
+                { "pitch", .rate = Rate::event },
+                { "gate", .rate = Rate::event },
+                { "velocity", .rate = Rate::event },
+                { "aftertouch", .rate = Rate::control },
+                { "pitchbend", .rate = Rate::control },
+                { "modulation", .rate = Rate::control },
                 
-                { "clock" },
-                { "start" },
-                { "continue" },
-                { "stop" },
+                { "clock", .rate = Rate::event },
+                { "start", .rate = Rate::event },
+                { "continue", .rate = Rate::event },
+                { "stop", .rate = Rate::event },
             };
 
             int pcount = midi.get_port_count();
@@ -149,33 +283,88 @@ namespace mdlr
             if (pcount == 0)
                 return;
 
-            midi.set_error_callback([](libremidi::midi_error type, std::string_view errorText) { fmt::println("Midi error: {}", errorText); });
+            midi.set_error_callback([](libremidi::midi_error type, std::string_view errorText) { trace(LogCategory::midi, "Midi error: {}", errorText); });
             midi.set_callback([&](const libremidi::message& message) { onMidiMessage(message); });
             midi.ignore_types(true, false, true);
             midi.open_port(bspport);
         }
 
-        virtual void process(float samplerate) override
+        virtual void process(float samplerate) override {}
+
+        virtual void processBlock(float samplerate, int frames) override
         {
-            #define handle_transport(type)      \
-                outs[slot_##type] = 0.f;        \
-                if (transport.type)             \
-                {                               \
-                    outs[slot_##type] = 1.f;    \
-                    transport.type = false;     \
+            // Held values step at the frame of the event that changed them
+            int cursor = 0;
+            auto advance = [&](int offset)
+            {
+                for (int i = slot_pitch; i <= slot_modulation; i++)
+                    if (outs[i].consumers > 0 && outs[i].rate != Rate::control)
+                        std::fill(outs[i].buffer.begin() + cursor, outs[i].buffer.begin() + offset, outs[i].signal);
+                cursor = offset;
+            };
+
+            // Transport messages are one-frame pulses, kept at least two frames apart so
+            // that consecutive ticks stay distinct rising edges
+            int last[4] = { -2, -2, -2, -2 };
+            for (int i = slot_clock; i <= slot_stop; i++)
+                std::fill_n(outs[i].buffer.begin(), frames, 0.f);
+            auto pulse = [&](int index, int offset)
+            {
+                offset = std::max(offset, last[index] + 2);
+                if (offset >= frames)
+                {
+                    pending[index]++;
+                    return;
                 }
+                outs[slot_clock + index].buffer[offset] = 1.f;
+                last[index] = offset;
+            };
+            for (int i = 0; i < 4; i++)
+            {
+                int count = std::exchange(pending[i], 0);
+                for (int p = 0; p < count; p++)
+                    pulse(i, 0);
+            }
 
-            handle_transport(clock);
-            handle_transport(start);
-            handle_transport(cont);
-            handle_transport(stop);
+            queue.drain(samplerate, frames, [&](int offset, const MidiEvent& event)
+            {
+                switch (event.type())
+                {
+                    case libremidi::message_type::NOTE_OFF:
+                    case libremidi::message_type::NOTE_ON:
+                        advance(offset);
+                        if (event.type() == libremidi::message_type::NOTE_ON && event.bytes[2] > 0)
+                        {
+                            lastnote = event.bytes[1];
+                            outs[slot_pitch].signal = midiToHerz(event.bytes[1]);
+                            outs[slot_velocity].signal = float(event.bytes[2]) / 127.f;
+                            outs[slot_gate].signal = 1.f;
+                        }
+                        else if (lastnote == event.bytes[1])
+                            outs[slot_gate].signal = 0.f;
+                        break;
+
+                    case libremidi::message_type::TIME_CLOCK: pulse(0, offset); break;
+                    case libremidi::message_type::START: pulse(1, offset); break;
+                    case libremidi::message_type::CONTINUE: pulse(2, offset); break;
+                    case libremidi::message_type::STOP: pulse(3, offset); break;
 
-            #undef handle_transport
+                    default:
+                        break;
+                }
+            });
+            advance(frames);
+            for (int i = slot_pitch; i <= slot_modulation; i++)
+                if (outs[i].consumers > 0 && outs[i].rate == Rate::control)
+                    outs[i].hold();
+
+            for (int i = slot_clock; i <= slot_stop; i++)
+                outs[i].signal = outs[i].buffer[frames - 1];
         }
 
         static float midiToHerz(char note, float root = 440.f)
         {
-            return root * std::pow(2.f, float(note - 69) / 12.f);
+            return fastmath::mtof(float(note), root);
         }
 
         void onMidiMessage(const libremidi::message& message)
@@ -183,60 +372,48 @@ namespace mdlr
             auto msgtype = message.get_message_type();
             auto channel = message.get_channel();
 
-            // if ((channel_mask & (0b1 << channel)) != 0)
-            // {
-                switch (msgtype)
-                {
-                    case libremidi::message_type::NOTE_OFF:
-                        outs[slot_gate] = lastnote == message[1] ? 0.f : outs[slot_gate];
-                        fmt::println("channel {} --> note off ({}, {})", channel, message[1], message[2]);
-                        break;
-                    
-                    case libremidi::message_type::NOTE_ON:
-                        lastnote = message[1];
-                        outs[slot_pitch] = midiToHerz(message[1]);
-                        outs[slot_velocity] = float(message[2]) / 127.f;
-                        outs[slot_gate] = message[2] == 0 ? 1.f : 0.f;
-                        fmt::println("channel {} --> note on ({}, {})", channel, message[1], message[2]);
-                        break;
-
-                    case libremidi::message_type::POLY_PRESSURE: break;
-                    case libremidi::message_type::CONTROL_CHANGE: break;
-                    case libremidi::message_type::PROGRAM_CHANGE: break;
-                    case libremidi::message_type::AFTERTOUCH: break;
-                    case libremidi::message_type::PITCH_BEND: break;
-                    default:
-                        break;
-                }
-            // }
-
             switch (msgtype)
             {
+                case libremidi::message_type::NOTE_OFF:
+                    trace(LogCategory::midi, "channel {} --> note off ({}, {})", channel, message[1], message[2]);
+                    queue.push(message);
+                    for (auto q: notes)
+                        q->push(message);
+                    break;
+
+                case libremidi::message_type::NOTE_ON:
+                    trace(LogCategory::midi, "channel {} --> note on ({}, {})", channel, message[1], message[2]);
+                    queue.push(message);
+                    for (auto q: notes)
+                        q->push(message);
+                    break;
+
                 case libremidi::message_type::TIME_CLOCK:
-                    transport.clock = true;
+                    queue.push(message);
                     break;
-                
+
                 case libremidi::message_type::START:
-                    fmt::println("START");
-                    transport.start = true;
+                    trace(LogCategory::midi, "START");
+                    queue.push(message);
                     break;
-                
+
                 case libremidi::message_type::CONTINUE:
-                    fmt::println("CONTINUE");
-                    transport.cont = true;
+                    trace(LogCategory::midi, "CONTINUE");
+                    queue.push(message);
                     break;
-                
+
                 case libremidi::message_type::STOP:
-                    fmt::println("STOP");
-                    transport.stop = true;
+                    trace(LogCategory::midi, "STOP");
+                    queue.push(message);
                     break;
 
-                case libremidi::message_type::ACTIVE_SENSING: break;
-                case libremidi::message_type::SYSTEM_RESET: break;
-
                 default:
                     break;
             }
         }
     };
+
+    MDLR_REGISTER_MODULE(MidiCC128);
+    MDLR_REGISTER_MODULE(MidiGate128);
+    MDLR_REGISTER_MODULE(MidiIn);
 }
\ No newline at end of file
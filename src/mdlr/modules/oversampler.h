@@ -0,0 +1,159 @@
+#pragma once
+
+#include "mdlr/module.h"
+#include "mdlr/halfband.h"
+
+#include <bit>
+
+namespace mdlr
+{
+    // Runs a wrapped module (or group) at `factor` times the engine rate, to keep the
+    // aliasing of nonlinearities out of the audible band. Inputs are interpolated and
+    // outputs decimated by cascaded 2x half-band stages; the wrapped module's slots are
+    // mirrored by name. Unconnected and control-rate inputs are held, not filtered.
+    struct Oversampler: Module
+    {
+        std::unique_ptr<Module> inner;
+        int factor;
+        int stages;
+
+        std::vector<std::vector<HalfbandUpsampler>> upsamplers;     // per input, lowest rate first
+        std::vector<std::vector<HalfbandDownsampler>> downsamplers; // per output, highest rate first
+        std::vector<Signal> scratch[2];
+
+        Oversampler(int factor, std::unique_ptr<Module> module)
+            : inner(std::move(module))
+            , factor(int(std::bit_ceil(unsigned(std::clamp(factor, 1, 8)))))
+            , stages(std::countr_zero(unsigned(this->factor)))
+        {
+            if (inner->name.empty())
+                inner->name = "inner";
+            for (auto& s: inner->ins)
+            {
+                auto& in = addInput(s.name, s.signal);
+                in.rate = s.rate;
+                in.interpolate = s.interpolate;
+            }
+            for (auto& s: inner->outs)
+                addOutput(s.name, s.signal).rate = s.rate;
+        }
+
+        // The first stage carries the whole audio band and needs the steep filter,
+        // later ones only have to reject images far above it
+        static int taps(int stage) { return stage == 0 ? 32 : 12; }
+
+        // In samples at the engine rate, for connected inputs
+        int latency() const
+        {
+            int result = 0;
+            for (int s = 0; s < stages; s++)
+                result += taps(s) >> s;
+            return result;
+        }
+
+        virtual void prepare(int blocksize) override
+        {
+            Module::prepare(blocksize);
+            inner->prepare(blocksize * factor);
+            scratch[0].assign(blocksize * factor, 0.f);
+            scratch[1].assign(blocksize * factor, 0.f);
+
+            upsamplers.assign(ins.size(), std::vector<HalfbandUpsampler>(stages));
+            for (auto& chain: upsamplers)
+                for (int s = 0; s < stages; s++)
+                    chain[s].prepare(taps(s), blocksize << s);
+
+            downsamplers.assign(outs.size(), std::vector<HalfbandDownsampler>(stages));
+            for (auto& chain: downsamplers)
+                for (int s = 0; s < stages; s++)
+                    chain[s].prepare(taps(stages - 1 - s), blocksize << (stages - 1 - s));
+        }
+
+        void upsample(std::vector<HalfbandUpsampler>& chain, const Signal* in, Signal* out, int frames)
+        {
+            if (chain.empty())
+                return (void) std::copy_n(in, frames, out);
+
+            const Signal* from = in;
+            for (size_t s = 0; s < chain.size(); s++)
+            {
+                Signal* to = s + 1 == chain.size() ? out : scratch[s & 1].data();
+                chain[s].process(from, to, frames);
+                from = to;
+                frames *= 2;
+            }
+        }
+
+        void downsample(std::vector<HalfbandDownsampler>& chain, const Signal* in, Signal* out, int frames)
+        {
+            if (chain.empty())
+                return (void) std::copy_n(in, frames, out);
+
+            const Signal* from = in;
+            int count = frames * factor;
+            for (size_t s = 0; s < chain.size(); s++)
+            {
+                Signal* to = s + 1 == chain.size() ? out : scratch[s & 1].data();
+                count /= 2;
+                chain[s].process(from, to, count);
+                from = to;
+            }
+        }
+
+        virtual void processBlock(float samplerate, int frames) override
+        {
+            for (size_t i = 0; i < ins.size(); i++)
+            {
+                auto& from = ins[i];
+                auto& to = inner->ins[i];
+                if (from.rate == Rate::control)
+                {
+                    to.settle(from.signal, frames * factor);
+                    continue;
+                }
+                to.signal = from.signal;
+                if (from.constant)
+                {
+                    to.hold();
+                    continue;
+                }
+                upsample(upsamplers[i], from.data, to.buffer.data(), frames);
+                to.data = to.buffer.data();
+                to.constant = false;
+            }
+
+            inner->processBlock(samplerate * factor, frames * factor);
+
+            for (size_t o = 0; o < outs.size(); o++)
+            {
+                downsample(downsamplers[o], inner->outs[o].data, outs[o].buffer.data(), frames);
+                outs[o].signal = outs[o].buffer[frames - 1];
+            }
+        }
+
+        // Per-sample path for legacy groups, through the block one with a single frame
+        virtual void process(float samplerate) override
+        {
+            for (auto& s: ins)
+            {
+                s.buffer[0] = s.signal;
+                s.data = s.buffer.data();
+                s.constant = s.sources.empty();
+            }
+            processBlock(samplerate, 1);
+        }
+
+        virtual Module* findModule(std::string_view path) override
+        {
+            auto dotpos = path.find(".");
+            if (path.substr(0, dotpos) != inner->name)
+                return nullptr;
+            return dotpos == std::string_view::npos
+                ? inner.get()
+                : inner->findModule(path.substr(dotpos + 1));
+        }
+
+        virtual void compileTree(Plans& plans) override { inner->compileTree(plans); }
+        virtual void randomize(int mode=0) override { inner->randomize(mode); }
+    };
+}
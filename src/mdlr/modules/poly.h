@@ -0,0 +1,276 @@
+#pragma once
+
+#include "mdlr/module.h"
+#include "mdlr/patch.h"
+#include "mdlr/modules/midi.h"
+
+#include <fmt/format.h>
+
+#include <cmath>
+#include <functional>
+
+namespace mdlr
+{
+    // Per-voice state kept as parallel arrays, so block-wide passes over the voices
+    // (level tracking, mixing, picking a voice to steal) run over contiguous floats.
+    struct VoiceAllocator
+    {
+        enum class Policy
+        {
+            oldest,     // steal the voice started the longest ago
+            quietest,   // steal the voice with the lowest output level
+            samenote,   // retrigger the voice already playing the note, else oldest
+        };
+
+        Policy policy = Policy::oldest;
+        std::vector<float> pitch;
+        std::vector<float> velocity;
+        std::vector<float> gate;
+        std::vector<float> level;
+        std::vector<int> note;
+        std::vector<uint64_t> age;
+        std::vector<uint8_t> active;
+        uint64_t clock = 0;
+
+        int size() const { return int(note.size()); }
+
+        void resize(int voices)
+        {
+            pitch.assign(voices, 0.f);
+            velocity.assign(voices, 0.f);
+            gate.assign(voices, 0.f);
+            level.assign(voices, 0.f);
+            note.assign(voices, -1);
+            age.assign(voices, 0);
+            active.assign(voices, 0);
+        }
+
+        // The voice a note on for this key would go to
+        int choose(int key) const
+        {
+            const int voice = policy == Policy::samenote ? find(key) : -1;
+            return voice >= 0 ? voice : pick();
+        }
+
+        // Returns the voice now playing the note
+        int noteOn(int key, float vel)
+        {
+            const int voice = choose(key);
+            pitch[voice] = MidiIn::midiToHerz(char(key));
+            velocity[voice] = vel;
+            gate[voice] = 1.f;
+            note[voice] = key;
+            age[voice] = ++clock;
+            active[voice] = 1;
+            return voice;
+        }
+
+        // Releases every gated voice playing the note, policies other than samenote can start
+        // it on several. Returns the first one released, or -1 when none plays the note.
+        int noteOff(int key)
+        {
+            const int first = find(key);
+            for (int v = first; v >= 0; v = find(key, v + 1))
+                gate[v] = 0.f;
+            return first;
+        }
+
+        // Released voices go idle once their output has decayed
+        void settle(int voice, float threshold = 1e-4f)
+        {
+            if (gate[voice] == 0.f && level[voice] < threshold)
+            {
+                active[voice] = 0;
+                note[voice] = -1;
+            }
+        }
+
+        // First gated voice from `from` on playing the note
+        int find(int key, int from = 0) const
+        {
+            for (int v = from; v < size(); v++)
+                if (active[v] && gate[v] > 0.f && note[v] == key)
+                    return v;
+            return -1;
+        }
+
+        // An idle voice if any, then a released one, then one picked by the policy
+        int pick() const
+        {
+            int best = -1;
+            for (int v = 0; v < size(); v++)
+                if (!active[v] && (best < 0 || age[v] < age[best]))
+                    best = v;
+            if (best >= 0)
+                return best;
+
+            for (int v = 0; v < size(); v++)
+                if (gate[v] == 0.f && (best < 0 || age[v] < age[best]))
+                    best = v;
+            if (best >= 0)
+                return best;
+
+            best = 0;
+            for (int v = 1; v < size(); v++)
+            {
+                if (policy == Policy::quietest ? level[v] < level[best] : age[v] < age[best])
+                    best = v;
+            }
+            return best;
+        }
+    };
+
+    // Instantiates a voice template N times and plays them from a stream of MIDI notes.
+    // Voices are groups exposing "pitch", "gate" and "velocity" inputs (all optional) and
+    // an "output", which are mixed together. Idle voices are not processed at all.
+    struct PolyGroup: Module
+    {
+        enum {
+            slot_output
+        };
+
+        using Builder = std::function<void(Group& voice)>;
+
+        struct Voice
+        {
+            std::unique_ptr<Group> group;
+            Slot* pitch;
+            Slot* gate;
+            Slot* velocity;
+            Slot* output;
+        };
+
+        std::vector<Voice> voices;
+        VoiceAllocator allocator;
+        std::vector<int> cursor;
+        Parameter* policy;
+        uint32_t policyseen = 0;
+
+        // Note on/off events. The queue is single producer: either one MidiIn pushes to it
+        // (see MidiIn::notes) or one other thread does, never both at once.
+        MidiEventQueue queue;
+
+        PolyGroup(int count, Builder build)
+        {
+            outs = {
+                { "output" }
+            };
+
+            allocator.resize(count);
+            cursor.assign(count, 0);
+            for (int v = 0; v < count; v++)
+            {
+                auto group = std::make_unique<Group>();
+                group->name = fmt::format("voice{}", v);
+                build(*group);
+                auto pitch = group->findInput("pitch");
+                auto gate = group->findInput("gate");
+                auto velocity = group->findInput("velocity");
+                auto output = group->findOutput("output");
+                voices.push_back({ std::move(group), pitch, gate, velocity, output });
+            }
+
+            policy = &addParameter("policy", int(allocator.policy)).range(0, int(VoiceAllocator::Policy::samenote));
+        }
+
+        // Every voice instantiated from the same patch
+        PolyGroup(int count, const Patch& voice)
+            : PolyGroup(count, [&voice](Group& group) { build(voice, group); })
+        {}
+
+        virtual void process(float samplerate) override {}
+
+        virtual void prepare(int blocksize) override
+        {
+            Module::prepare(blocksize);
+            for (auto& v: voices)
+                v.group->prepare(blocksize);
+        }
+
+        // Steps a voice's control inputs up to the given frame with its current values
+        void advance(int v, int offset)
+        {
+            auto& voice = voices[v];
+            for (auto [slot, value]: { std::pair(voice.pitch, allocator.pitch[v]), std::pair(voice.gate, allocator.gate[v]), std::pair(voice.velocity, allocator.velocity[v]) })
+            {
+                if (!slot)
+                    continue;
+                slot->signal = value;
+                std::fill(slot->buffer.begin() + cursor[v], slot->buffer.begin() + offset, value);
+                slot->data = slot->buffer.data();
+                slot->constant = false;
+            }
+            cursor[v] = offset;
+        }
+
+        virtual void processBlock(float samplerate, int frames) override
+        {
+            if (policy->changed(policyseen))
+                allocator.policy = VoiceAllocator::Policy(policy->get<int>());
+            std::fill(cursor.begin(), cursor.end(), 0);
+            queue.drain(samplerate, frames, [&](int offset, const MidiEvent& event)
+            {
+                const bool on = event.type() == libremidi::message_type::NOTE_ON && event.bytes[2] > 0;
+                const bool off = event.type() == libremidi::message_type::NOTE_OFF || event.type() == libremidi::message_type::NOTE_ON;
+                if (!on && !off)
+                    return;
+
+                const int key = event.bytes[1] & 0x7F;
+                if (on)
+                {
+                    advance(allocator.choose(key), offset);
+                    allocator.noteOn(key, float(event.bytes[2]) / 127.f);
+                    return;
+                }
+                for (int v = allocator.find(key); v >= 0; v = allocator.find(key, v + 1))
+                    advance(v, offset);
+                allocator.noteOff(key);
+            });
+
+            Signal* output = outs[slot_output].buffer.data();
+            std::fill_n(output, frames, 0.f);
+            for (int v = 0; v < allocator.size(); v++)
+            {
+                if (!allocator.active[v])
+                    continue;
+
+                advance(v, frames);
+                auto& voice = voices[v];
+                voice.group->processBlock(samplerate, frames);
+
+                float peak = 0.f;
+                if (voice.output)
+                {
+                    const Signal* data = voice.output->data;
+                    for (int f = 0; f < frames; f++)
+                    {
+                        output[f] += data[f];
+                        peak = std::max(peak, std::abs(data[f]));
+                    }
+                }
+                allocator.level[v] = peak;
+                allocator.settle(v);
+            }
+        }
+
+        virtual void compileTree(Plans& plans) override
+        {
+            for (auto& v: voices)
+                v.group->compileTree(plans);
+        }
+
+        virtual Module* findModule(std::string_view path) override
+        {
+            auto dotpos = path.find(".");
+            auto stub = path.substr(0, dotpos);
+            for (auto& v: voices)
+            {
+                if (v.group->name == stub)
+                    return dotpos == std::string_view::npos
+                        ? v.group.get()
+                        : v.group->findModule(path.substr(dotpos + 1));
+            }
+            return nullptr;
+        }
+    };
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "mdlr/module.h"
+#include "mdlr/registry.h"
 #include "mdlr/util.h"
 
 #include <array>
@@ -31,13 +32,13 @@ namespace mdlr
         Sequencer()
         {
             ins = {
-                { "clock" },
-                { "reset" },
-                { "randomize" },
+                { "clock", .rate = Rate::event },
+                { "reset", .rate = Rate::event },
+                { "randomize", .rate = Rate::event },
             };
             outs = {
-                { "pitch" },
-                { "velocity" },
+                { "pitch", .rate = Rate::event },
+                { "velocity", .rate = Rate::event },
             };
         }
 
@@ -120,25 +121,25 @@ namespace mdlr
         MetropolisSequencer()
         {
             ins = {
-                { "clock" },
-                { "reset" },
-                { "randomize" },
+                { "clock", .rate = Rate::event },
+                { "reset", .rate = Rate::event },
+                { "randomize", .rate = Rate::event },
             };
             outs = {
                 { "pitch" },
-                { "gate" },
-                { "velocity" },
-                { "index" },
-                { "end" },
-
-                { "step0" },
-                { "step1" },
-                { "step2" },
-                { "step3" },
-                { "step4" },
-                { "step5" },
-                { "step6" },
-                { "step7" },
+                { "gate", .rate = Rate::event },
+                { "velocity", .rate = Rate::event },
+                { "index", .rate = Rate::event },
+                { "end", .rate = Rate::event },
+
+                { "step0", .rate = Rate::event },
+                { "step1", .rate = Rate::event },
+                { "step2", .rate = Rate::event },
+                { "step3", .rate = Rate::event },
+                { "step4", .rate = Rate::event },
+                { "step5", .rate = Rate::event },
+                { "step6", .rate = Rate::event },
+                { "step7", .rate = Rate::event },
             };
         }
 
@@ -214,4 +215,7 @@ namespace mdlr
             ticks++;
         }
     };
+
+    MDLR_REGISTER_MODULE(Sequencer);
+    MDLR_REGISTER_MODULE(MetropolisSequencer);
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "mdlr/module.h"
+#include "mdlr/registry.h"
+#include "mdlr/simd.h"
+#include "mdlr/wavetable.h"
+
+#include <cstring>
+
+namespace mdlr
+{
+    // Reads a band-limited table from the shared bank, picking the mip level from the
+    // frequency and morphing between the table frames with the position input.
+    struct WavetableOscillator: Module
+    {
+        enum {
+            slot_frequency,
+            slot_position,
+        };
+
+        enum {
+            slot_output,
+        };
+
+        float phase = 0.f;
+        const Wavetable* table = nullptr;
+        Parameter* tableparam;
+
+        WavetableOscillator()
+        {
+            ins = {
+                { "frequency", .signal = 120.f },
+                { "position", .signal = 0.f },
+            };
+            outs = {
+                { "output" }
+            };
+            tableparam = &addParameter("table", std::string("saw")).staging();
+            table = WavetableBank::instance().find(tableparam->string());
+        }
+
+        // Control thread: finding or loading the table may allocate and read files
+        virtual void prepareParameter(Parameter& parameter, const ParameterValue& value, Memory& payload) override
+        {
+            if (&parameter != tableparam || !std::holds_alternative<std::string>(value))
+                return;
+            const Wavetable* resolved = WavetableBank::instance().resolve(std::get<std::string>(value));
+            payload = Memory::allocate(sizeof(resolved));
+            memcpy(payload.data, &resolved, sizeof(resolved));
+        }
+
+        // Audio thread, or the calling thread through setParameter(): swaps the name so the
+        // old string is freed with the retired command
+        virtual void applyParameter(Parameter& parameter, ParameterValue&& value, Memory& payload) override
+        {
+            if (&parameter != tableparam)
+                return Module::applyParameter(parameter, std::move(value), payload);
+
+            const Wavetable* resolved = nullptr;
+            if (payload.data)
+                memcpy(&resolved, payload.data, sizeof(resolved));
+            if (!resolved)
+                return;
+            table = resolved;
+            parameter.set(std::move(value));
+        }
+
+        float read(float increment, float position) const
+        {
+            const int level = Wavetable::level(std::abs(increment));
+            const float index = clamp(position, 0.f, 1.f) * float(table->frames - 1);
+            const int frame = int(index);
+            const float a = table->sample(frame, level, phase);
+            if (frame + 1 >= table->frames)
+                return a;
+            const float b = table->sample(frame + 1, level, phase);
+            return a + (index - float(frame)) * (b - a);
+        }
+
+        virtual void process(float samplerate) override
+        {
+            if (!table)
+            {
+                outs[slot_output] = 0.f;
+                return;
+            }
+            const float increment = ins[slot_frequency] / samplerate;
+            outs[slot_output] = read(increment, ins[slot_position]);
+            phase = simd::wrap(phase + increment);
+        }
+
+        virtual void processBlock(float samplerate, int frames) override
+        {
+            Signal* output = outs[slot_output].buffer.data();
+            if (!table)
+            {
+                std::fill_n(output, frames, 0.f);
+                return;
+            }
+
+            const Signal* frequency = ins[slot_frequency].data;
+            const Signal* position = ins[slot_position].data;
+            const float invsr = 1.f / samplerate;
+            for (int f = 0; f < frames; f++)
+            {
+                const float increment = frequency[f] * invsr;
+                output[f] = read(increment, position[f]);
+                phase = simd::wrap(phase + increment);
+            }
+        }
+    };
+
+    MDLR_REGISTER_MODULE(WavetableOscillator)
+        .range("frequency", 0.f, 24000.f)
+        .range("position", 0.f, 1.f);
+}
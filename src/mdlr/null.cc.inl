@@ -0,0 +1,87 @@
+#include "mdlr/driver.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+namespace mdlr
+{
+    // Simulated device: a thread calls the callback every period, optionally paced to
+    // the wall clock, and can route the outputs of one period back to the next inputs.
+    struct NullDriver: Driver
+    {
+        bool sleep = true;
+        bool loopback = false;
+        std::vector<float> ins;
+        std::vector<float> outs;
+        std::thread thread;
+        std::atomic<bool> running = false;
+
+        ~NullDriver() { stop(); }
+
+        virtual bool configure(const DriverConfiguration& configuration) override
+        {
+            stop();
+            samplerate = configuration.samplerate;
+            buffersize = configuration.buffersize;
+            capture.channels = configuration.capture.channels;
+            playback.channels = configuration.playback.channels;
+            sleep = configuration.null.sleep;
+            loopback = configuration.null.loopback;
+            ins.assign(size_t(buffersize) * capture.channels, 0.f);
+            outs.assign(size_t(buffersize) * playback.channels, 0.f);
+            return samplerate > 0 && buffersize > 0;
+        }
+
+        virtual void start() override
+        {
+            if (running.exchange(true))
+                return;
+            thread = std::thread([this] { run(); });
+        }
+
+        virtual void stop() override
+        {
+            if (!running.exchange(false))
+                return;
+            thread.join();
+        }
+
+        void run()
+        {
+            using clock = std::chrono::steady_clock;
+            const auto period = std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<double>(double(buffersize) / samplerate));
+
+            auto deadline = clock::now();
+            while (running.load(std::memory_order_relaxed))
+            {
+                if (loopback)
+                {
+                    // Extra inputs read silence, extra outputs are dropped
+                    const int channels = std::min(capture.channels, playback.channels);
+                    for (int f = 0; f < buffersize; f++)
+                        for (int c = 0; c < channels; c++)
+                            ins[f*capture.channels + c] = outs[f*playback.channels + c];
+                }
+
+                callback(capture.channels > 0 ? ins.data() : nullptr, outs.data(), buffersize);
+
+                if (sleep)
+                {
+                    // A callback late by more than a period would have underrun a real device
+                    deadline += period;
+                    const auto now = clock::now();
+                    if (now > deadline + period)
+                    {
+                        xruns.fetch_add(1, std::memory_order_relaxed);
+                        deadline = now;
+                    }
+                    std::this_thread::sleep_until(deadline);
+                }
+            }
+        }
+    };
+}
@@ -0,0 +1,210 @@
+#include "mdlr/driver.h"
+#include "mdlr/log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+namespace mdlr
+{
+    // Renders as fast as possible, calling the callback in a tight loop from start().
+    // Input and output are interleaved float32, either raw or wrapped in a WAV file.
+    struct OfflineDriver: Driver
+    {
+        std::string inputpath;
+        std::string outputpath;
+        std::vector<float>* outputbuffer = nullptr;
+        int64_t frames = 0;
+        std::vector<float> input;
+        std::atomic<bool> stopping = false;
+
+        static bool isWav(std::string_view path)
+        {
+            return path.size() >= 4 && (path.ends_with(".wav") || path.ends_with(".WAV"));
+        }
+
+        virtual bool configure(const DriverConfiguration& configuration) override
+        {
+            samplerate = configuration.samplerate;
+            buffersize = configuration.buffersize;
+            capture.channels = configuration.capture.channels;
+            playback.channels = configuration.playback.channels;
+            inputpath = configuration.offline.input;
+            outputpath = configuration.offline.output;
+            outputbuffer = configuration.offline.buffer;
+            frames = configuration.offline.frames;
+
+            input.clear();
+            if (!inputpath.empty() && !load(inputpath))
+                return false;
+
+            if (frames <= 0)
+                frames = capture.channels > 0 ? int64_t(input.size()) / capture.channels : 0;
+            return true;
+        }
+
+        virtual bool realtime() const override { return false; }
+
+        virtual void start() override
+        {
+            stopping = false;
+            std::vector<float> ins(size_t(buffersize) * capture.channels, 0.f);
+            std::vector<float> outs(size_t(buffersize) * playback.channels, 0.f);
+
+            FILE* file = nullptr;
+            if (!outputpath.empty())
+            {
+                file = fopen(outputpath.c_str(), "wb");
+                if (!file)
+                {
+                    trace(LogCategory::driver, "Offline: cannot open {}", outputpath);
+                    return;
+                }
+                if (isWav(outputpath))
+                    writeWavHeader(file, 0);
+            }
+
+            if (outputbuffer)
+            {
+                outputbuffer->clear();
+                outputbuffer->reserve(size_t(frames) * playback.channels);
+            }
+
+            int64_t written = 0;
+            const int64_t available = capture.channels > 0 ? int64_t(input.size()) / capture.channels : 0;
+            while (written < frames && !stopping.load(std::memory_order_relaxed))
+            {
+                const int count = int(std::min<int64_t>(buffersize, frames - written));
+                for (int f = 0; f < count; f++)
+                {
+                    const int64_t frame = written + f;
+                    for (int c = 0; c < capture.channels; c++)
+                        ins[f*capture.channels + c] = frame < available ? input[frame*capture.channels + c] : 0.f;
+                }
+
+                callback(capture.channels > 0 ? ins.data() : nullptr, outs.data(), count);
+
+                const size_t samples = size_t(count) * playback.channels;
+                if (file)
+                    fwrite(outs.data(), sizeof(float), samples, file);
+                if (outputbuffer)
+                    outputbuffer->insert(outputbuffer->end(), outs.begin(), outs.begin() + samples);
+                written += count;
+            }
+
+            if (file)
+            {
+                if (isWav(outputpath))
+                {
+                    fseek(file, 0, SEEK_SET);
+                    writeWavHeader(file, uint32_t(written * playback.channels * sizeof(float)));
+                }
+                fclose(file);
+            }
+        }
+
+        virtual void stop() override { stopping = true; }
+
+        void writeWavHeader(FILE* file, uint32_t datasize)
+        {
+            auto u32 = [&](uint32_t v) { fwrite(&v, 4, 1, file); };
+            auto u16 = [&](uint16_t v) { fwrite(&v, 2, 1, file); };
+            fwrite("RIFF", 1, 4, file);
+            u32(36 + datasize);
+            fwrite("WAVEfmt ", 1, 8, file);
+            u32(16);
+            u16(3); // IEEE float
+            u16(uint16_t(playback.channels));
+            u32(uint32_t(samplerate));
+            u32(uint32_t(samplerate * playback.channels * sizeof(float)));
+            u16(uint16_t(playback.channels * sizeof(float)));
+            u16(32);
+            fwrite("data", 1, 4, file);
+            u32(datasize);
+        }
+
+        bool load(const std::string& path)
+        {
+            FILE* file = fopen(path.c_str(), "rb");
+            if (!file)
+            {
+                trace(LogCategory::driver, "Offline: cannot open {}", path);
+                return false;
+            }
+
+            std::vector<uint8_t> bytes;
+            uint8_t chunk[4096];
+            while (size_t n = fread(chunk, 1, sizeof(chunk), file))
+                bytes.insert(bytes.end(), chunk, chunk + n);
+            fclose(file);
+
+            if (!isWav(path))
+            {
+                input.resize(bytes.size() / sizeof(float));
+                memcpy(input.data(), bytes.data(), input.size() * sizeof(float));
+                return true;
+            }
+
+            auto u32 = [&](size_t at) { uint32_t v; memcpy(&v, bytes.data() + at, 4); return v; };
+            auto u16 = [&](size_t at) { uint16_t v; memcpy(&v, bytes.data() + at, 2); return v; };
+            if (bytes.size() < 12 || memcmp(bytes.data(), "RIFF", 4) != 0 || memcmp(bytes.data() + 8, "WAVE", 4) != 0)
+            {
+                trace(LogCategory::driver, "Offline: {} is not a WAV file", path);
+                return false;
+            }
+
+            int format = 0;
+            int bits = 0;
+            int channels = 0;
+            for (size_t at = 12; at + 8 <= bytes.size();)
+            {
+                const uint32_t size = u32(at + 4);
+                const size_t body = at + 8;
+                if (body + size > bytes.size())
+                    break;
+
+                if (memcmp(bytes.data() + at, "fmt ", 4) == 0 && size >= 16)
+                {
+                    format = u16(body);
+                    channels = u16(body + 2);
+                    if (int(u32(body + 4)) != samplerate)
+                        trace(LogCategory::driver, "Offline: {} is {}Hz, rendering at {}Hz", path, u32(body + 4), samplerate);
+                    bits = u16(body + 14);
+                    if (format == 0xFFFE && size >= 26)
+                        format = u16(body + 24);
+                }
+                else if (memcmp(bytes.data() + at, "data", 4) == 0)
+                {
+                    if (format == 3 && bits == 32)
+                    {
+                        input.resize(size / sizeof(float));
+                        memcpy(input.data(), bytes.data() + body, input.size() * sizeof(float));
+                    }
+                    else if (format == 1 && bits == 16)
+                    {
+                        input.resize(size / sizeof(int16_t));
+                        for (size_t i = 0; i < input.size(); i++)
+                        {
+                            int16_t v;
+                            memcpy(&v, bytes.data() + body + i * sizeof(int16_t), sizeof(int16_t));
+                            input[i] = float(v) / 32768.f;
+                        }
+                    }
+                    else
+                    {
+                        trace(LogCategory::driver, "Offline: unsupported WAV format {} ({} bits)", format, bits);
+                        return false;
+                    }
+                    capture.channels = channels;
+                    return true;
+                }
+                at = body + size + (size & 1);
+            }
+
+            trace(LogCategory::driver, "Offline: {} has no audio data", path);
+            return false;
+        }
+    };
+}
@@ -0,0 +1,672 @@
+#include "mdlr/patch.h"
+#include "mdlr/registry.h"
+#include "mdlr/log.h"
+
+#include <fmt/format.h>
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+namespace mdlr
+{
+    namespace
+    {
+        enum class Tag: uint8_t
+        {
+            boolean,
+            integer,
+            real,
+            string,
+        };
+
+        // Splits off the next whitespace separated token
+        std::string_view token(std::string_view& line)
+        {
+            auto start = line.find_first_not_of(" \t");
+            if (start == std::string_view::npos)
+            {
+                line = {};
+                return {};
+            }
+            line.remove_prefix(start);
+            auto end = std::min(line.find_first_of(" \t"), line.size());
+            auto result = line.substr(0, end);
+            line.remove_prefix(end);
+            return result;
+        }
+
+        template <typename T>
+        bool number(std::string_view text, T& value)
+        {
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            return error == std::errc() && end == text.data() + text.size();
+        }
+
+        // "acid.seq.gate" -> "acid.seq", "gate". Top level names have an empty parent.
+        std::pair<std::string_view, std::string_view> split(std::string_view path)
+        {
+            auto dotpos = path.rfind('.');
+            if (dotpos == std::string_view::npos)
+                return { {}, path };
+            return { path.substr(0, dotpos), path.substr(dotpos + 1) };
+        }
+
+        // Blobs have no ==, and never count as changed since they are not serialized
+        bool differs(const ParameterValue& a, const ParameterValue& b)
+        {
+            if (a.index() != b.index())
+                return true;
+            return std::visit([&](const auto& value)
+            {
+                using T = std::decay_t<decltype(value)>;
+                if constexpr (std::is_same_v<T, std::span<uint8_t>>)
+                    return false;
+                else
+                    return !(value == std::get<T>(b));
+            }, a);
+        }
+
+        // Tables are written in host byte order, patches are not meant to travel across endianness
+        struct Writer
+        {
+            std::vector<uint8_t>& data;
+
+            template <typename T>
+            void put(const T& value)
+            {
+                auto bytes = (const uint8_t*) &value;
+                data.insert(data.end(), bytes, bytes + sizeof(T));
+            }
+        };
+
+        struct Reader
+        {
+            std::span<const uint8_t> data;
+            size_t position = 0;
+
+            template <typename T>
+            bool get(T& value)
+            {
+                if (data.size() - position < sizeof(T))
+                    return false;
+                memcpy(&value, data.data() + position, sizeof(T));
+                position += sizeof(T);
+                return true;
+            }
+
+            bool get(std::string& value, uint32_t length)
+            {
+                if (data.size() - position < length)
+                    return false;
+                value.assign((const char*) data.data() + position, length);
+                position += length;
+                return true;
+            }
+        };
+    }
+
+    uint32_t Patch::intern(std::string_view string)
+    {
+        auto [it, inserted] = lookup.try_emplace(std::string(string), uint32_t(strings.size()));
+        if (inserted)
+            strings.emplace_back(string);
+        return it->second;
+    }
+
+    std::string Patch::text() const
+    {
+        std::string result;
+        for (const auto& node: nodes)
+            result += fmt::format("module {} {}\n", string(node.path), string(node.type));
+        for (const auto& port: ports)
+            result += fmt::format("{} {}\n", port.output ? "output" : "input", string(port.path));
+        for (const auto& value: values)
+            result += fmt::format("set {} {}\n", string(value.path), value.value);
+        for (const auto& wire: wires)
+            result += fmt::format("connect {} {}\n", string(wire.from), string(wire.to));
+        for (const auto& setting: settings)
+        {
+            auto path = string(setting.path);
+            if (auto v = std::get_if<bool>(&setting.value))
+                result += fmt::format("param {} bool {}\n", path, *v);
+            else if (auto v = std::get_if<int>(&setting.value))
+                result += fmt::format("param {} int {}\n", path, *v);
+            else if (auto v = std::get_if<float>(&setting.value))
+                result += fmt::format("param {} float {}\n", path, *v);
+            else if (auto v = std::get_if<std::string>(&setting.value))
+                result += fmt::format("param {} string {}\n", path, *v);
+        }
+        return result;
+    }
+
+    bool Patch::parseText(std::string_view text, Patch& patch)
+    {
+        int row = 0;
+        while (!text.empty())
+        {
+            auto eol = std::min(text.find('\n'), text.size());
+            auto line = text.substr(0, eol);
+            text.remove_prefix(std::min(eol + 1, text.size()));
+            row++;
+
+            if (auto comment = line.find('#'); comment != std::string_view::npos)
+                line = line.substr(0, comment);
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+
+            auto keyword = token(line);
+            if (keyword.empty())
+                continue;
+
+            auto first = token(line);
+            bool valid = !first.empty();
+            if (keyword == "module")
+            {
+                auto type = token(line);
+                valid = valid && !type.empty();
+                if (valid)
+                    patch.addModule(first, type);
+            }
+            else if (keyword == "input" || keyword == "output")
+            {
+                if (valid)
+                    patch.addPort(first, keyword == "output");
+            }
+            else if (keyword == "set")
+            {
+                Signal value = 0.f;
+                valid = valid && number(token(line), value);
+                if (valid)
+                    patch.setSignal(first, value);
+            }
+            else if (keyword == "connect")
+            {
+                auto to = token(line);
+                valid = valid && !to.empty();
+                if (valid)
+                    patch.connect(first, to);
+            }
+            else if (keyword == "param")
+            {
+                // An empty path leaves the type empty as well
+                auto type = token(line);
+                auto rest = line.substr(std::min(line.find_first_not_of(" \t"), line.size()));
+                int i = 0;
+                float f = 0.f;
+                if (type == "bool" && (rest == "true" || rest == "false"))
+                    patch.setParameter(first, rest == "true");
+                else if (type == "int" && number(rest, i))
+                    patch.setParameter(first, i);
+                else if (type == "float" && number(rest, f))
+                    patch.setParameter(first, f);
+                else if (type == "string")
+                    patch.setParameter(first, std::string(rest));
+                else
+                    valid = false;
+            }
+            else
+                valid = false;
+
+            if (!valid)
+            {
+                trace(LogCategory::engine, "Patch: invalid line {}", row);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> Patch::binary() const
+    {
+        // Unset values and blobs are left out
+        auto serializable = [](const Setting& s)
+        {
+            return !std::holds_alternative<std::monostate>(s.value) && !std::holds_alternative<std::span<uint8_t>>(s.value);
+        };
+
+        std::vector<uint8_t> data;
+        Writer writer { data };
+        writer.put(Magic);
+        writer.put(Version);
+        for (auto size: { strings.size(), nodes.size(), ports.size(), values.size(), wires.size() })
+            writer.put(uint32_t(size));
+        writer.put(uint32_t(std::count_if(settings.begin(), settings.end(), serializable)));
+
+        for (const auto& s: strings)
+        {
+            writer.put(uint32_t(s.size()));
+            data.insert(data.end(), s.begin(), s.end());
+        }
+        for (const auto& node: nodes)
+        {
+            writer.put(node.path);
+            writer.put(node.type);
+        }
+        for (const auto& port: ports)
+        {
+            writer.put(port.path);
+            writer.put(uint8_t(port.output));
+        }
+        for (const auto& value: values)
+        {
+            writer.put(value.path);
+            writer.put(value.value);
+        }
+        for (const auto& wire: wires)
+        {
+            writer.put(wire.from);
+            writer.put(wire.to);
+        }
+
+        for (const auto& setting: settings)
+        {
+            if (auto v = std::get_if<bool>(&setting.value))
+            {
+                writer.put(setting.path);
+                writer.put(Tag::boolean);
+                writer.put(uint8_t(*v));
+            }
+            else if (auto v = std::get_if<int>(&setting.value))
+            {
+                writer.put(setting.path);
+                writer.put(Tag::integer);
+                writer.put(int32_t(*v));
+            }
+            else if (auto v = std::get_if<float>(&setting.value))
+            {
+                writer.put(setting.path);
+                writer.put(Tag::real);
+                writer.put(*v);
+            }
+            else if (auto v = std::get_if<std::string>(&setting.value))
+            {
+                writer.put(setting.path);
+                writer.put(Tag::string);
+                writer.put(uint32_t(v->size()));
+                data.insert(data.end(), v->begin(), v->end());
+            }
+        }
+        return data;
+    }
+
+    bool Patch::parseBinary(std::span<const uint8_t> data, Patch& patch)
+    {
+        Reader reader { data };
+        uint32_t magic = 0;
+        uint32_t version = 0;
+        uint32_t counts[6] = {};
+        bool valid = reader.get(magic) && magic == Magic
+            && reader.get(version) && version == Version;
+        for (auto& count: counts)
+            valid = valid && reader.get(count);
+
+        // Every record takes at least 4 bytes, which bounds what a corrupt header can reserve
+        const size_t total = size_t(counts[0]) + counts[1] + counts[2] + counts[3] + counts[4] + counts[5];
+        if (!valid || total > data.size() / 4)
+        {
+            trace(LogCategory::engine, "Patch: invalid binary header");
+            return false;
+        }
+
+        const uint32_t base = uint32_t(patch.strings.size());
+        patch.strings.reserve(base + counts[0]);
+        patch.lookup.reserve(base + counts[0]);
+        patch.nodes.reserve(patch.nodes.size() + counts[1]);
+        patch.ports.reserve(patch.ports.size() + counts[2]);
+        patch.values.reserve(patch.values.size() + counts[3]);
+        patch.wires.reserve(patch.wires.size() + counts[4]);
+        patch.settings.reserve(patch.settings.size() + counts[5]);
+
+        // Strings are already unique in a well formed file, interning them again
+        // remaps the indices when appending to a non-empty patch
+        std::vector<uint32_t> remap(counts[0]);
+        std::string s;
+        for (auto& index: remap)
+        {
+            uint32_t length = 0;
+            valid = valid && reader.get(length) && reader.get(s, length);
+            if (!valid)
+                break;
+            index = patch.intern(s);
+        }
+
+        auto string = [&](uint32_t& index)
+        {
+            uint32_t raw = 0;
+            if (!reader.get(raw) || raw >= remap.size())
+                return false;
+            index = remap[raw];
+            return true;
+        };
+
+        for (uint32_t i = 0; valid && i < counts[1]; i++)
+        {
+            Node node;
+            valid = string(node.path) && string(node.type);
+            patch.nodes.push_back(node);
+        }
+        for (uint32_t i = 0; valid && i < counts[2]; i++)
+        {
+            Port port;
+            uint8_t output = 0;
+            valid = string(port.path) && reader.get(output);
+            port.output = output != 0;
+            patch.ports.push_back(port);
+        }
+        for (uint32_t i = 0; valid && i < counts[3]; i++)
+        {
+            Value value;
+            valid = string(value.path) && reader.get(value.value);
+            patch.values.push_back(value);
+        }
+        for (uint32_t i = 0; valid && i < counts[4]; i++)
+        {
+            Wire wire;
+            valid = string(wire.from) && string(wire.to);
+            patch.wires.push_back(wire);
+        }
+        for (uint32_t i = 0; valid && i < counts[5]; i++)
+        {
+            Setting setting;
+            Tag tag;
+            valid = string(setting.path) && reader.get(tag);
+            if (!valid)
+                break;
+
+            switch (tag)
+            {
+                case Tag::boolean: { uint8_t v = 0; valid = reader.get(v); setting.value = v != 0; break; }
+                case Tag::integer: { int32_t v = 0; valid = reader.get(v); setting.value = int(v); break; }
+                case Tag::real: { float v = 0.f; valid = reader.get(v); setting.value = v; break; }
+                case Tag::string:
+                {
+                    uint32_t length = 0;
+                    std::string v;
+                    valid = reader.get(length) && reader.get(v, length);
+                    setting.value = std::move(v);
+                    break;
+                }
+                default: valid = false; break;
+            }
+            patch.settings.push_back(std::move(setting));
+        }
+
+        if (!valid)
+            trace(LogCategory::engine, "Patch: truncated or corrupt binary data");
+        return valid;
+    }
+
+    bool Patch::save(std::string_view path, bool binary) const
+    {
+        FILE* file = fopen(std::string(path).c_str(), "wb");
+        if (!file)
+            return false;
+        bool written = false;
+        if (binary)
+        {
+            auto data = this->binary();
+            written = fwrite(data.data(), 1, data.size(), file) == data.size();
+        }
+        else
+        {
+            auto data = text();
+            written = fwrite(data.data(), 1, data.size(), file) == data.size();
+        }
+        fclose(file);
+        return written;
+    }
+
+    bool Patch::load(std::string_view path, Patch& patch)
+    {
+        FILE* file = fopen(std::string(path).c_str(), "rb");
+        if (!file)
+        {
+            trace(LogCategory::engine, "Patch: cannot open {}", path);
+            return false;
+        }
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        std::vector<uint8_t> data(size > 0 ? size_t(size) : 0);
+        bool read = fread(data.data(), 1, data.size(), file) == data.size();
+        fclose(file);
+        if (!read)
+            return false;
+
+        uint32_t magic = 0;
+        if (data.size() >= sizeof(magic))
+            memcpy(&magic, data.data(), sizeof(magic));
+        if (magic == Magic)
+            return parseBinary(data, patch);
+        return parseText(std::string_view((const char*) data.data(), data.size()), patch);
+    }
+
+    bool build(const Patch& patch, Group& group, const ModuleFactory& factory)
+    {
+        // Path -> module table, the root group has the empty path. Views point into the patch strings.
+        std::unordered_map<std::string_view, Module*> modules;
+        modules.reserve(patch.nodes.size() + 1);
+        modules.emplace(std::string_view(), &group);
+
+        std::unordered_map<std::string_view, uint32_t> children;
+        children.reserve(patch.nodes.size() + 1);
+        for (const auto& node: patch.nodes)
+            children[split(patch.string(node.path)).first]++;
+
+        auto reserve = [&](Group& g, std::string_view path)
+        {
+            auto it = children.find(path);
+            if (it != children.end())
+                g.modules.reserve(g.modules.size() + it->second);
+        };
+        reserve(group, {});
+
+        for (const auto& node: patch.nodes)
+        {
+            auto path = patch.string(node.path);
+            auto type = patch.string(node.type);
+            auto [parentpath, name] = split(path);
+            auto parent = modules.find(parentpath);
+            auto parentgroup = parent != modules.end() ? dynamic_cast<Group*>(parent->second) : nullptr;
+            if (!parentgroup)
+            {
+                trace(LogCategory::engine, "Patch: no group to hold {}", path);
+                return false;
+            }
+
+            auto module = type == "Group"
+                ? std::make_unique<Group>()
+                : factory ? factory(type) : Registry::instance().create(type);
+            if (!module)
+            {
+                trace(LogCategory::engine, "Patch: unknown module type {} for {}", type, path);
+                return false;
+            }
+            auto& m = parentgroup->add(name, std::move(module));
+            if (auto g = dynamic_cast<Group*>(&m))
+                reserve(*g, path);
+            modules.emplace(path, &m);
+        }
+
+        auto owner = [&](std::string_view path) -> std::pair<Module*, std::string_view>
+        {
+            auto [modulepath, name] = split(path);
+            auto it = modules.find(modulepath);
+            return { it != modules.end() ? it->second : nullptr, name };
+        };
+
+        auto find = [](stable_vector<Slot>& slots, std::string_view name) -> Slot*
+        {
+            for (auto& s: slots)
+                if (s.name == name)
+                    return &s;
+            return nullptr;
+        };
+
+        // Group ports are seen from inside as well: their inputs are sources, their outputs targets
+        auto slot = [&](std::string_view path, bool output) -> Slot*
+        {
+            auto [m, name] = owner(path);
+            if (!m)
+                return nullptr;
+            Slot* s = find(output ? m->outs : m->ins, name);
+            if (!s && dynamic_cast<Group*>(m))
+                s = find(output ? m->ins : m->outs, name);
+            return s;
+        };
+
+        for (const auto& port: patch.ports)
+        {
+            auto path = patch.string(port.path);
+            auto [m, name] = owner(path);
+            if (!m)
+            {
+                trace(LogCategory::engine, "Patch: no module to hold port {}", path);
+                return false;
+            }
+            if (port.output)
+                m->addOutput(name);
+            else
+                m->addInput(name);
+        }
+
+        for (const auto& value: patch.values)
+        {
+            auto s = slot(patch.string(value.path), false);
+            if (!s)
+            {
+                trace(LogCategory::engine, "Patch: unknown input {}", patch.string(value.path));
+                return false;
+            }
+            s->signal = value.value;
+        }
+
+        for (const auto& wire: patch.wires)
+        {
+            auto from = slot(patch.string(wire.from), true);
+            auto to = slot(patch.string(wire.to), false);
+            if (!from || !to)
+            {
+                trace(LogCategory::engine, "Patch: cannot connect {} to {}", patch.string(wire.from), patch.string(wire.to));
+                return false;
+            }
+            from->connect(*to);
+        }
+
+        for (const auto& setting: patch.settings)
+        {
+            auto path = patch.string(setting.path);
+            auto [m, name] = owner(path);
+            Parameter* parameter = nullptr;
+            if (m)
+                for (auto& p: m->parameters)
+                    if (p.name == name)
+                        parameter = &p;
+
+            // Parameters only accept values of their type
+            if (!parameter || parameter->type != setting.value.index())
+            {
+                trace(LogCategory::engine, "Patch: cannot set parameter {}", path);
+                return false;
+            }
+            m->setParameter(*parameter, setting.value);
+        }
+        return true;
+    }
+
+    bool capture(Group& group, Patch& patch)
+    {
+        auto& registry = Registry::instance();
+
+        // Slot -> path, for every slot a wire can start from
+        std::unordered_map<const Slot*, std::string> paths;
+        auto name = [](const std::string& prefix, std::string_view name)
+        {
+            return prefix.empty() ? std::string(name) : fmt::format("{}.{}", prefix, name);
+        };
+        for (auto& s: group.ins)
+            paths.emplace(&s, s.name);
+        for (auto& s: group.outs)
+            paths.emplace(&s, s.name);
+
+        // Parents are listed before their children
+        struct Entry
+        {
+            Module* module;
+            std::string path;
+            const ModuleInfo* info;
+        };
+        std::vector<Entry> entries;
+        auto walk = [&](auto&& self, Group& g, const std::string& prefix) -> bool
+        {
+            for (auto& m: g.modules)
+            {
+                auto info = registry.find(*m);
+                auto path = name(prefix, m->name);
+                if (!info)
+                {
+                    trace(LogCategory::engine, "Patch: {} has no registered type", path);
+                    return false;
+                }
+                patch.addModule(path, info->type);
+                for (auto& s: m->ins)
+                    paths.emplace(&s, name(path, s.name));
+                for (auto& s: m->outs)
+                    paths.emplace(&s, name(path, s.name));
+                entries.push_back({ m.get(), path, info });
+
+                if (auto sub = dynamic_cast<Group*>(m.get()))
+                {
+                    for (auto& s: sub->ins)
+                        patch.addPort(name(path, s.name), false);
+                    for (auto& s: sub->outs)
+                        patch.addPort(name(path, s.name), true);
+                    if (!self(self, *sub, path))
+                        return false;
+                }
+            }
+            return true;
+        };
+        if (!walk(walk, group, {}))
+            return false;
+
+        auto wires = [&](const Slot& to)
+        {
+            for (auto src: to.sources)
+            {
+                auto it = paths.find(src);
+                if (it != paths.end())
+                    patch.connect(it->second, paths[&to]);
+            }
+        };
+        for (auto& s: group.outs)
+            wires(s);
+
+        for (const auto& [module, path, info]: entries)
+        {
+            const bool isgroup = dynamic_cast<Group*>(module) != nullptr;
+            for (uint32_t i = 0; i < module->ins.size(); i++)
+            {
+                const auto& s = module->ins[i];
+                const Signal fallback = i < info->ins.size() ? info->ins[i].value : 0.f;
+                if (s.sources.empty() && s.signal != fallback)
+                    patch.setSignal(name(path, s.name), s.signal);
+                wires(s);
+            }
+            if (isgroup)
+                for (auto& s: module->outs)
+                    wires(s);
+
+            for (auto& p: module->parameters)
+            {
+                ParameterValue value = p;
+                auto fallback = info->parameter(p.name);
+                if (fallback && !differs(value, fallback->value))
+                    continue;
+                patch.setParameter(name(path, p.name), std::move(value));
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "mdlr/module.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mdlr
+{
+    // Serializable description of a graph: modules by type name, group ports, input values,
+    // wires and parameter values. Paths are dotted and relative to the group the patch is
+    // built into. Every string is interned once, records only hold indices into `strings`.
+    //
+    // Text form, one record per line, '#' starts a comment:
+    //     module acid Group
+    //     module acid.seq MetropolisSequencer
+    //     input acid.clock
+    //     output acid.output
+    //     set acid.env.a 0.01
+    //     connect acid.seq.gate acid.env.gate
+    //     param acid.seq.gatelen float 0.02
+    //
+    // Modules must come after their parent group. The binary form holds the same tables,
+    // prefixed with their sizes so a reader allocates everything up front.
+    struct Patch
+    {
+        static constexpr uint32_t Magic = 0x504c444d;   // "MDLP"
+        static constexpr uint32_t Version = 1;
+
+        struct Node
+        {
+            uint32_t path;
+            uint32_t type;
+        };
+
+        // Input or output added to a group
+        struct Port
+        {
+            uint32_t path;
+            bool output;
+        };
+
+        struct Value
+        {
+            uint32_t path;
+            Signal value;
+        };
+
+        struct Wire
+        {
+            uint32_t from;
+            uint32_t to;
+        };
+
+        // Blobs are views on memory the patch does not own and are never serialized
+        struct Setting
+        {
+            uint32_t path;
+            ParameterValue value;
+        };
+
+        std::vector<std::string> strings;
+        std::vector<Node> nodes;
+        std::vector<Port> ports;
+        std::vector<Value> values;
+        std::vector<Wire> wires;
+        std::vector<Setting> settings;
+
+        uint32_t intern(std::string_view string);
+        std::string_view string(uint32_t index) const { return strings[index]; }
+
+        void addModule(std::string_view path, std::string_view type) { nodes.push_back({ intern(path), intern(type) }); }
+        void addPort(std::string_view path, bool output) { ports.push_back({ intern(path), output }); }
+        void setSignal(std::string_view path, Signal value) { values.push_back({ intern(path), value }); }
+        void connect(std::string_view from, std::string_view to) { wires.push_back({ intern(from), intern(to) }); }
+        void setParameter(std::string_view path, ParameterValue value) { settings.push_back({ intern(path), std::move(value) }); }
+
+        std::string text() const;
+        std::vector<uint8_t> binary() const;
+        static bool parseText(std::string_view text, Patch& patch);
+        static bool parseBinary(std::span<const uint8_t> data, Patch& patch);
+
+        // Binary files are told apart from text ones by their magic number
+        bool save(std::string_view path, bool binary = false) const;
+        static bool load(std::string_view path, Patch& patch);
+
+    private:
+        std::unordered_map<std::string, uint32_t> lookup;
+    };
+
+    // Makes a module from its type name, or returns nullptr for an unknown type.
+    // Groups ("Group") are made by the builder itself.
+    using ModuleFactory = std::function<std::unique_ptr<Module>(std::string_view type)>;
+
+    // Instantiates the patch into `group` in a single pass over each table: groups reserve
+    // their children up front and paths resolve through a table of the created modules
+    // rather than by walking names. Types come from the Registry unless a factory is given.
+    // Stops at the first unknown type or path and returns false.
+    bool build(const Patch& patch, Group& group, const ModuleFactory& factory = {});
+
+    // Describes the children of `group`, the ports of nested groups, the wires between them
+    // and the inputs and parameters that differ from their type's defaults. The group's own
+    // ports are left to whoever builds the patch. Fails on a module of an unregistered type.
+    bool capture(Group& group, Patch& patch);
+}
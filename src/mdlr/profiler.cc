@@ -0,0 +1,90 @@
+#include "mdlr/profiler.h"
+#include "mdlr/module.h"
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace mdlr
+{
+    double profiler::nanosecondsPerTick()
+    {
+        static const double value = []
+        {
+            const auto start = std::chrono::steady_clock::now();
+            const uint64_t first = ticks();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            const uint64_t last = ticks();
+            const auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::nano>(end - start).count() / double(std::max<uint64_t>(last - first, 1));
+        }();
+        return value;
+    }
+
+#if defined(MDLR_PROFILE)
+    static void appendRow(std::string& result, const Module& module, std::string_view path, int depth, float samplerate, int blocksize)
+    {
+        const auto& p = module.profile;
+        const uint64_t blocks = p.blocks.load(std::memory_order_relaxed);
+        const uint64_t frames = p.frames.load(std::memory_order_relaxed);
+        const double tick = profiler::nanosecondsPerTick();
+        const double total = p.total.load(std::memory_order_relaxed) * tick;
+        const double budget = 1e9 / samplerate;
+
+        if (blocks == 0)
+            result += fmt::format("{:<40} {:>10}\n", fmt::format("{:{}}{}", "", 2 * depth, path), "-");
+        else
+            result += fmt::format("{:<40} {:>10} {:>10.0f} {:>10.0f} {:>10.0f} {:>7.2f}% {:>7.2f}%\n"
+                , fmt::format("{:{}}{}", "", 2 * depth, path)
+                , blocks
+                , p.min.load(std::memory_order_relaxed) * tick
+                , total / blocks
+                , p.max.load(std::memory_order_relaxed) * tick
+                , 100. * total / (frames * budget)
+                , 100. * p.max.load(std::memory_order_relaxed) * tick / (blocksize * budget));
+
+        if (auto group = dynamic_cast<const Group*>(&module))
+        {
+            for (const auto& m: group->modules)
+                appendRow(result, *m, m->name, depth + 1, samplerate, blocksize);
+        }
+    }
+#endif // defined(MDLR_PROFILE)
+
+    std::string profileTable([[maybe_unused]] const Group& group, [[maybe_unused]] float samplerate, [[maybe_unused]] int blocksize)
+    {
+    #if defined(MDLR_PROFILE)
+        std::string result = fmt::format("{:<40} {:>10} {:>10} {:>10} {:>10} {:>8} {:>8}\n"
+            , "module", "blocks", "min ns", "avg ns", "max ns", "avg %", "max %");
+        appendRow(result, group, group.name.empty() ? "system" : group.name, 0, samplerate, blocksize);
+        return result;
+    #else
+        return "profiling is compiled out, build with MDLR_PROFILE\n";
+    #endif
+    }
+
+    bool profileDump(const Group& group, float samplerate, int blocksize, std::string_view path)
+    {
+        FILE* file = fopen(std::string(path).c_str(), "w");
+        if (!file)
+            return false;
+        auto table = profileTable(group, samplerate, blocksize);
+        fwrite(table.data(), 1, table.size(), file);
+        fclose(file);
+        return true;
+    }
+
+    void profileReset([[maybe_unused]] Group& group)
+    {
+    #if defined(MDLR_PROFILE)
+        group.profile.reset();
+        for (auto& m: group.modules)
+        {
+            if (auto g = dynamic_cast<Group*>(m.get()))
+                profileReset(*g);
+            else
+                m->profile.reset();
+        }
+    #endif
+    }
+}
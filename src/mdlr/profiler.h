@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#include <chrono>
+#endif
+
+namespace mdlr
+{
+    struct Group;
+
+    namespace profiler
+    {
+        // Raw timestamp counter, converted to nanoseconds only when reporting
+        inline uint64_t ticks()
+        {
+        #if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+            return __rdtsc();
+        #elif defined(__aarch64__)
+            uint64_t value;
+            asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+            return value;
+        #else
+            return std::chrono::steady_clock::now().time_since_epoch().count();
+        #endif
+        }
+
+        // Measured once against the steady clock
+        double nanosecondsPerTick();
+    }
+
+    // Written by the audio thread only, read by anyone. Single writer so plain
+    // load/store pairs are enough, no read-modify-write on the hot path.
+    struct ProfileCounter
+    {
+        std::atomic<uint64_t> blocks = 0;
+        std::atomic<uint64_t> frames = 0;
+        std::atomic<uint64_t> total = 0;
+        std::atomic<uint64_t> min = ~0ull;
+        std::atomic<uint64_t> max = 0;
+
+        void record(uint64_t ticks, int count)
+        {
+            blocks.store(blocks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            frames.store(frames.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+            total.store(total.load(std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+            if (ticks < min.load(std::memory_order_relaxed))
+                min.store(ticks, std::memory_order_relaxed);
+            if (ticks > max.load(std::memory_order_relaxed))
+                max.store(ticks, std::memory_order_relaxed);
+        }
+
+        // Racy against record(), a block landing mid-reset is simply lost
+        void reset()
+        {
+            blocks = 0;
+            frames = 0;
+            total = 0;
+            min = ~0ull;
+            max = 0;
+        }
+    };
+
+    struct ProfileScope
+    {
+        ProfileCounter& counter;
+        int frames;
+        uint64_t start = profiler::ticks();
+
+        ~ProfileScope() { counter.record(profiler::ticks() - start, frames); }
+    };
+
+    // Per-module table of min/avg/max time per block and share of the callback budget,
+    // nested groups are listed under their own (inclusive) row.
+    std::string profileTable(const Group& group, float samplerate, int blocksize);
+    bool profileDump(const Group& group, float samplerate, int blocksize, std::string_view path);
+    void profileReset(Group& group);
+}
+
+#if defined(MDLR_PROFILE)
+#define MDLR_PROFILE_SCOPE(counter, frames) ::mdlr::ProfileScope __mdlr_profile_scope { counter, frames }
+#else
+#define MDLR_PROFILE_SCOPE(counter, frames)
+#endif
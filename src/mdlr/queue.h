@@ -0,0 +1,131 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <bit>
+
+namespace mdlr
+{
+    // Bounded wait-free single producer / single consumer ring.
+    // Items are move-assigned in and out so the storage never allocates after construction.
+    template <typename T>
+    struct SpscQueue
+    {
+        std::vector<T> items;
+        size_t mask = 0;
+        alignas(64) std::atomic<size_t> head = 0;
+        alignas(64) std::atomic<size_t> tail = 0;
+
+        SpscQueue(size_t capacity)
+            : items(std::bit_ceil(capacity))
+            , mask(items.size() - 1)
+        {}
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        size_t capacity() const { return items.size(); }
+        size_t size() const { return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+        bool empty() const { return size() == 0; }
+
+        // Producer side
+        bool push(T&& item)
+        {
+            const size_t t = tail.load(std::memory_order_relaxed);
+            if (t - head.load(std::memory_order_acquire) == items.size())
+                return false;
+            items[t & mask] = std::move(item);
+            tail.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side
+        T* front()
+        {
+            const size_t h = head.load(std::memory_order_relaxed);
+            if (h == tail.load(std::memory_order_acquire))
+                return nullptr;
+            return &items[h & mask];
+        }
+
+        void pop() { head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+        bool pop(T& item)
+        {
+            T* f = front();
+            if (!f)
+                return false;
+            item = std::move(*f);
+            pop();
+            return true;
+        }
+    };
+
+    // Bounded lock-free multiple producer / single consumer ring (Vyukov's sequenced cells).
+    // Producers never block: push() fails when the ring is full.
+    template <typename T>
+    struct MpscQueue
+    {
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            T item;
+        };
+
+        std::vector<Cell> cells;
+        size_t mask = 0;
+        alignas(64) std::atomic<size_t> tail = 0;
+        alignas(64) size_t head = 0;
+
+        MpscQueue(size_t capacity)
+            : cells(std::bit_ceil(capacity))
+            , mask(cells.size() - 1)
+        {
+            for (size_t i = 0; i < cells.size(); i++)
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        size_t capacity() const { return cells.size(); }
+
+        // Any thread
+        bool push(T&& item)
+        {
+            size_t pos = tail.load(std::memory_order_relaxed);
+            Cell* cell = nullptr;
+            while (true)
+            {
+                cell = &cells[pos & mask];
+                const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+                const auto diff = intptr_t(sequence) - intptr_t(pos);
+                if (diff == 0)
+                {
+                    if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0)
+                    return false;
+                else
+                    pos = tail.load(std::memory_order_relaxed);
+            }
+            cell->item = std::move(item);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer side
+        bool pop(T& item)
+        {
+            Cell& cell = cells[head & mask];
+            const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            if (intptr_t(sequence) - intptr_t(head + 1) < 0)
+                return false;
+            item = std::move(cell.item);
+            cell.sequence.store(head + mask + 1, std::memory_order_release);
+            head++;
+            return true;
+        }
+    };
+}
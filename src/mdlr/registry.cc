@@ -0,0 +1,112 @@
+#include "mdlr/registry.h"
+
+#include <algorithm>
+
+namespace mdlr
+{
+    template <typename Info>
+    static const Info* byName(const std::vector<Info>& list, std::string_view name)
+    {
+        for (const auto& i: list)
+            if (i.name == name)
+                return &i;
+        return nullptr;
+    }
+
+    const SlotInfo* ModuleInfo::input(std::string_view name) const { return byName(ins, name); }
+    const SlotInfo* ModuleInfo::output(std::string_view name) const { return byName(outs, name); }
+    const ParameterInfo* ModuleInfo::parameter(std::string_view name) const { return byName(parameters, name); }
+
+    Registry::Registry()
+    {
+        add<Group>("Group");
+    }
+
+    Registry& Registry::instance()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    ModuleInfo& Registry::add(std::string_view type, std::type_index id, ModuleInfo::Factory factory)
+    {
+        std::lock_guard lock(mutex);
+        auto& info = entries[std::string(type)];
+        if (!info)
+            info = std::make_unique<ModuleInfo>();
+        info->type = type;
+        info->factory = std::move(factory);
+        info->described = false;
+        typeids[id] = info.get();
+        return *info;
+    }
+
+    std::unique_ptr<Module> Registry::create(std::string_view type) const
+    {
+        auto it = entries.find(type);
+        return it != entries.end() ? it->second->factory() : nullptr;
+    }
+
+    const ModuleInfo* Registry::find(std::string_view type)
+    {
+        std::lock_guard lock(mutex);
+        auto it = entries.find(type);
+        return it != entries.end() ? describe(it->second.get()) : nullptr;
+    }
+
+    const ModuleInfo* Registry::find(const Module& module)
+    {
+        std::lock_guard lock(mutex);
+        auto it = typeids.find(typeid(module));
+        return it != typeids.end() ? describe(it->second) : nullptr;
+    }
+
+    std::vector<std::string_view> Registry::types() const
+    {
+        std::vector<std::string_view> result;
+        result.reserve(entries.size());
+        for (const auto& [type, info]: entries)
+            result.push_back(type);
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    // Called with the lock held. Constructing the prototype may have side effects
+    // (MIDI modules open their port), which is why it waits for the first query.
+    const ModuleInfo* Registry::describe(ModuleInfo* info)
+    {
+        if (info->described)
+            return info;
+
+        auto prototype = info->factory();
+        auto slots = [&](const stable_vector<Slot>& from, std::vector<SlotInfo>& to)
+        {
+            to.clear();
+            to.reserve(from.size());
+            for (const auto& s: from)
+            {
+                SlotInfo slot = {
+                    .name = s.name,
+                    .index = uint32_t(to.size()),
+                    .rate = s.rate,
+                    .value = s.signal
+                };
+                if (auto range = byName(info->ranges, s.name))
+                {
+                    slot.min = range->min;
+                    slot.max = range->max;
+                }
+                to.push_back(std::move(slot));
+            }
+        };
+        slots(prototype->ins, info->ins);
+        slots(prototype->outs, info->outs);
+
+        info->parameters.clear();
+        for (auto& p: prototype->parameters)
+            info->parameters.push_back({ .name = p.name, .index = uint32_t(info->parameters.size()), .value = ParameterValue(p) });
+
+        info->described = true;
+        return info;
+    }
+}
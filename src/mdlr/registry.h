@@ -0,0 +1,100 @@
+#pragma once
+
+#include "mdlr/module.h"
+
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace mdlr
+{
+    struct SlotInfo
+    {
+        std::string name;
+        uint32_t index = 0;
+        Rate rate = Rate::audio;
+        Signal value = 0.f;
+        Signal min = -std::numeric_limits<Signal>::infinity();
+        Signal max = std::numeric_limits<Signal>::infinity();
+    };
+
+    struct ParameterInfo
+    {
+        std::string name;
+        uint32_t index = 0;
+        ParameterValue value;       // the default, its alternative is the parameter's type
+    };
+
+    // A registered module type. Slots and parameters are read from a prototype instance
+    // the first time they are asked for, ranges are declared at registration.
+    struct ModuleInfo
+    {
+        using Factory = std::function<std::unique_ptr<Module>()>;
+
+        std::string type;
+        Factory factory;
+        std::vector<SlotInfo> ins;
+        std::vector<SlotInfo> outs;
+        std::vector<ParameterInfo> parameters;
+
+        ModuleInfo& range(std::string_view slot, Signal min, Signal max)
+        {
+            ranges.push_back({ .name = std::string(slot), .min = min, .max = max });
+            return *this;
+        }
+
+        const SlotInfo* input(std::string_view name) const;
+        const SlotInfo* output(std::string_view name) const;
+        const ParameterInfo* parameter(std::string_view name) const;
+
+    private:
+        friend struct Registry;
+        std::vector<SlotInfo> ranges;
+        bool described = false;
+    };
+
+    // Type name -> factory and metadata, so graphs can be built from data. Module headers
+    // register their default constructible types with MDLR_REGISTER_MODULE, only the types
+    // whose header is part of the program are known.
+    struct Registry
+    {
+        static Registry& instance();
+
+        template <typename Mod>
+        ModuleInfo& add(std::string_view type)
+        {
+            return add(type, typeid(Mod), [] { return std::unique_ptr<Module>(std::make_unique<Mod>()); });
+        }
+        ModuleInfo& add(std::string_view type, std::type_index id, ModuleInfo::Factory factory);
+
+        // Unknown types give nullptr
+        std::unique_ptr<Module> create(std::string_view type) const;
+        const ModuleInfo* find(std::string_view type);
+        const ModuleInfo* find(const Module& module);
+        std::vector<std::string_view> types() const;
+
+    private:
+        Registry();
+        const ModuleInfo* describe(ModuleInfo* info);
+
+        struct Hash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+        };
+
+        std::unordered_map<std::string, std::unique_ptr<ModuleInfo>, Hash, std::equal_to<>> entries;
+        std::unordered_map<std::type_index, ModuleInfo*> typeids;
+        std::mutex mutex;
+    };
+}
+
+// At namespace scope in a module header, after the type. Chain .range() to declare slot ranges.
+#define MDLR_REGISTER_MODULE(Type) \
+    inline const ::mdlr::ModuleInfo& registered##Type = ::mdlr::Registry::instance().add<Type>(#Type)
@@ -0,0 +1,149 @@
+#include "mdlr/scheduler.h"
+#include "mdlr/module.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <pthread.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#include <immintrin.h>
+#define MDLR_PAUSE() _mm_pause()
+#elif defined(__aarch64__)
+#define MDLR_PAUSE() asm volatile("yield")
+#else
+#define MDLR_PAUSE()
+#endif
+
+namespace mdlr
+{
+    static constexpr uint64_t pack(uint32_t epoch, uint32_t cursor, uint32_t end)
+    {
+        return (uint64_t(epoch) << 32) | (uint64_t(cursor & 0xFFFF) << 16) | (end & 0xFFFF);
+    }
+
+    Scheduler::Scheduler(int threads)
+        : queues(new Queue[std::max(threads, 1)])
+        , queuecount(std::max(threads, 1))
+    {
+        // Workers start from the epoch as of now: one starting late, after the destructor already
+        // bumped it, must see that bump rather than wait for the next
+        running = true;
+        const uint32_t seen = epoch.load(std::memory_order_relaxed);
+        for (int q = 1; q < queuecount; q++)
+        {
+            workers.emplace_back([this, q, seen] { loop(q, seen); });
+
+        #if defined(__linux__) || defined(__APPLE__)
+            // Best effort, needs the right privileges
+            sched_param param = { .sched_priority = sched_get_priority_max(SCHED_FIFO) - 1 };
+            pthread_setschedparam(workers.back().native_handle(), SCHED_FIFO, &param);
+        #endif
+        }
+    }
+
+    Scheduler::~Scheduler()
+    {
+        running = false;
+        epoch.fetch_add(1, std::memory_order_release);
+        epoch.notify_all();
+        for (auto& w: workers)
+            w.join();
+    }
+
+    void Scheduler::run(Group& group, float samplerate, int frames)
+    {
+        auto& plan = group.plan;
+        this->group = &group;
+        this->samplerate = samplerate;
+        this->frames = frames;
+        uint32_t* tasks = plan.tasks.data();
+
+        // Waves run one after the other, the partitions of a wave run concurrently
+        for (size_t w = 0; w + 1 < plan.waves.size(); w++)
+        {
+            const uint32_t first = plan.waves[w];
+            const uint32_t count = plan.waves[w + 1] - first;
+            if (count == 1)
+            {
+                const auto& partition = plan.partitions[first];
+                group.runSteps(partition.first, partition.count, samplerate, frames);
+                continue;
+            }
+
+            // Round robin over the partitions, which come sorted heaviest first
+            remaining.store(count, std::memory_order_relaxed);
+            const uint32_t wave = epoch.load(std::memory_order_relaxed) + 1;
+            uint32_t slot = 0;
+            for (int q = 0; q < queuecount; q++)
+            {
+                const uint32_t begin = slot;
+                for (uint32_t p = q; p < count; p += queuecount)
+                    tasks[slot++] = first + p;
+                queues[q].range.store(pack(wave, begin, slot), std::memory_order_release);
+            }
+
+            epoch.store(wave, std::memory_order_release);
+            epoch.notify_all();
+
+            work(wave, 0);
+            while (remaining.load(std::memory_order_acquire) != 0)
+                MDLR_PAUSE();
+        }
+    }
+
+    bool Scheduler::take(Queue& queue, uint32_t wave, uint32_t& task)
+    {
+        uint64_t range = queue.range.load(std::memory_order_acquire);
+        while (true)
+        {
+            const uint32_t cursor = (range >> 16) & 0xFFFF;
+            const uint32_t end = range & 0xFFFF;
+            if (uint32_t(range >> 32) != wave || cursor >= end)
+                return false;
+            if (queue.range.compare_exchange_weak(range, pack(wave, cursor + 1, end), std::memory_order_acquire))
+            {
+                task = group->plan.tasks[cursor];
+                return true;
+            }
+        }
+    }
+
+    void Scheduler::work(uint32_t wave, int queue)
+    {
+        for (int i = 0; i < queuecount; i++)
+        {
+            auto& q = queues[(queue + i) % queuecount];
+            uint32_t task;
+            while (take(q, wave, task))
+            {
+                const auto& partition = group->plan.partitions[task];
+                group->runSteps(partition.first, partition.count, samplerate, frames);
+                remaining.fetch_sub(1, std::memory_order_release);
+            }
+        }
+    }
+
+    void Scheduler::loop(int queue, uint32_t seen)
+    {
+        while (true)
+        {
+            // Spin briefly before sleeping, blocks come back every few milliseconds
+            uint32_t current = epoch.load(std::memory_order_acquire);
+            for (int spin = 0; spin < 4096 && current == seen; spin++)
+            {
+                MDLR_PAUSE();
+                current = epoch.load(std::memory_order_acquire);
+            }
+            if (current == seen)
+            {
+                epoch.wait(seen, std::memory_order_acquire);
+                continue;
+            }
+
+            seen = current;
+            if (!running.load(std::memory_order_relaxed))
+                return;
+            work(seen, queue);
+        }
+    }
+}
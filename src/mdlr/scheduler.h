@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace mdlr
+{
+    struct Group;
+
+    // Runs the partitions of a group plan on a pool of worker threads plus the calling
+    // (audio) thread, one wave at a time. Each thread owns a range of the wave's partitions
+    // and steals from the others' ranges once its own is exhausted. Cursors carry the wave
+    // epoch, so a thread that wakes up late can never claim work from another wave.
+    struct Scheduler
+    {
+        struct alignas(64) Queue
+        {
+            // epoch:32 | cursor:16 | end:16, tasks are indices into the plan's tasks
+            std::atomic<uint64_t> range = 0;
+        };
+
+        std::vector<std::thread> workers;
+        std::unique_ptr<Queue[]> queues;
+        int queuecount = 0;
+
+        alignas(64) std::atomic<uint32_t> epoch = 0;
+        alignas(64) std::atomic<uint32_t> remaining = 0;
+        std::atomic<bool> running = false;
+
+        // Current wave, only read by a thread holding one of its tasks
+        Group* group = nullptr;
+        float samplerate = 0.f;
+        int frames = 0;
+
+        // `threads` counts the caller, so threads - 1 workers are spawned
+        explicit Scheduler(int threads);
+        ~Scheduler();
+
+        // Audio thread: runs every partition of the group's plan and returns once they are done
+        void run(Group& group, float samplerate, int frames);
+
+        void work(uint32_t wave, int queue);
+        bool take(Queue& queue, uint32_t wave, uint32_t& task);
+        void loop(int queue, uint32_t seen);
+    };
+}
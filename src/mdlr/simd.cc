@@ -0,0 +1,113 @@
+#include "mdlr/simd.h"
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define MDLR_SIMD_NEON
+#elif defined(__x86_64__) || defined(_M_X64)
+#define MDLR_SIMD_X86
+#endif
+
+namespace mdlr::simd
+{
+    // The kernels are plain loops over branchless code, the compiler vectorizes them for
+    // each target they are instantiated in. Keep them free of calls and data-dependent
+    // branches or they fall back to scalar code.
+    template <Accuracy accuracy>
+    static inline void sineKernel(const float* __restrict phase, float* __restrict out, int count)
+    {
+        for (int i = 0; i < count; i++)
+            out[i] = sine<accuracy>(phase[i]);
+    }
+
+    template <Accuracy accuracy>
+    static inline void sineKernelInPlace(float* data, int count)
+    {
+        for (int i = 0; i < count; i++)
+            data[i] = sine<accuracy>(data[i]);
+    }
+
+    using SineKernel = void (*)(const float*, float*, int);
+
+    template <Accuracy accuracy>
+    static void sineGeneric(const float* phase, float* out, int count)
+    {
+        if (phase == out)
+            sineKernelInPlace<accuracy>(out, count);
+        else
+            sineKernel<accuracy>(phase, out, count);
+    }
+
+#if defined(MDLR_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+    template <Accuracy accuracy>
+    __attribute__((target("avx2,fma"))) static void sineAvx2(const float* phase, float* out, int count)
+    {
+        if (phase == out)
+            sineKernelInPlace<accuracy>(out, count);
+        else
+            sineKernel<accuracy>(phase, out, count);
+    }
+#endif
+
+    struct Dispatch
+    {
+        Isa isa = Isa::scalar;
+        SineKernel sine[3] = { &sineGeneric<Accuracy::fast>, &sineGeneric<Accuracy::normal>, &sineGeneric<Accuracy::precise> };
+
+        Dispatch()
+        {
+        #if defined(MDLR_SIMD_NEON)
+            isa = Isa::neon;
+        #elif defined(MDLR_SIMD_X86)
+            isa = Isa::sse2;
+        #if defined(__GNUC__) || defined(__clang__)
+            if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+            {
+                isa = Isa::avx2;
+                sine[0] = &sineAvx2<Accuracy::fast>;
+                sine[1] = &sineAvx2<Accuracy::normal>;
+                sine[2] = &sineAvx2<Accuracy::precise>;
+            }
+        #endif
+        #endif
+        }
+    };
+
+    static const Dispatch dispatch;
+
+    Isa isa() { return dispatch.isa; }
+
+    const char* name(Isa isa)
+    {
+        switch (isa)
+        {
+            case Isa::scalar: return "scalar";
+            case Isa::sse2: return "sse2";
+            case Isa::avx2: return "avx2";
+            case Isa::neon: return "neon";
+        }
+        return "";
+    }
+
+    void sine(const float* phase, float* out, int count, Accuracy accuracy)
+    {
+        dispatch.sine[int(accuracy)](phase, out, count);
+    }
+
+    float ramp(float phase, const float* increment, float* out, int count)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            const float step = increment[i];
+            out[i] = phase;
+            phase = wrap(phase + step);
+        }
+        return phase;
+    }
+
+    // Constant increment: every phase is computed from the start, so the loop vectorizes
+    float ramp(float phase, float increment, float* out, int count)
+    {
+        for (int i = 0; i < count; i++)
+            out[i] = wrap(phase + increment * float(i));
+        return wrap(phase + increment * float(count));
+    }
+}
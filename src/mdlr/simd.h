@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cmath>
+
+namespace mdlr::simd
+{
+    // Instruction set the block kernels were dispatched to at startup
+    enum class Isa
+    {
+        scalar,
+        sse2,
+        avx2,
+        neon,
+    };
+
+    // Odd polynomials for sin(2*pi*phase), max absolute error 7e-5, 7e-7 and 2e-7 (float bound)
+    enum class Accuracy
+    {
+        fast,
+        normal,
+        precise,
+    };
+
+    Isa isa();
+    const char* name(Isa isa);
+
+    // Fractional part, a vectorizable floor for phases within int range
+    inline float wrap(float phase)
+    {
+        const float t = float(int(phase));
+        return phase - t + float(t > phase);
+    }
+
+    // Reduces a phase in [0, 1) to z in [-1, 1] such that sin(2*pi*phase) = -sin(pi/2*z)
+    inline float fold(float phase)
+    {
+        const float y = phase - 0.5f;
+        const float a = std::abs(y);
+        const float b = 0.5f - a;
+        return std::copysign(4.f * (a < b ? a : b), y);
+    }
+
+    template <Accuracy accuracy>
+    inline float sinehalfpi(float z)
+    {
+        const float z2 = z * z;
+        if constexpr (accuracy == Accuracy::fast)
+            return z * (1.5703203f + z2 * (-0.64211425f + z2 * 0.071861648f));
+        else if constexpr (accuracy == Accuracy::normal)
+            return z * (1.5707910f + z2 * (-0.64589288f + z2 * (0.079434404f + z2 * -0.0043331269f)));
+        else
+            return z * (1.5707963f + z2 * (-0.64596336f + z2 * (0.079688482f + z2 * (-0.0046722301f + z2 * 0.00015082150f))));
+    }
+
+    // sin(2*pi*phase) for a phase in [0, 1)
+    template <Accuracy accuracy = Accuracy::normal>
+    inline float sine(float phase) { return -sinehalfpi<accuracy>(fold(phase)); }
+
+    // Block versions, dispatched to the widest instruction set available.
+    // Phases must be in [0, 1), `out` may alias `phase`.
+    void sine(const float* phase, float* out, int count, Accuracy accuracy = Accuracy::normal);
+
+    // Phase accumulator without fmod: out[f] is the phase before step f, in [0, 1).
+    // Returns the phase after the last step, `out` may alias `increment`.
+    float ramp(float phase, const float* increment, float* out, int count);
+    float ramp(float phase, float increment, float* out, int count);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace mdlr
+{
+    // A value derived from a control input and the samplerate (a step size, a filter pole),
+    // recomputed only when either of them changes. Reading it costs a compare.
+    struct Coefficient
+    {
+        float input = std::numeric_limits<float>::quiet_NaN();
+        float samplerate = 0.f;
+        float value = 0.f;
+
+        template <typename Derive>
+        float operator()(float x, float sr, Derive&& derive)
+        {
+            if (x != input || sr != samplerate)
+            {
+                input = x;
+                samplerate = sr;
+                value = derive(x, sr);
+            }
+            return value;
+        }
+    };
+
+    // One-pole smoothing towards a target: value += coefficient * (target - value), with a
+    // coefficient of frequency / samplerate cached across blocks
+    struct Smoother
+    {
+        float value = 0.f;
+        float coefficient = 1.f;
+        Coefficient cache;
+
+        void prepare(float samplerate, float frequency)
+        {
+            coefficient = cache(frequency, samplerate, [](float freq, float sr) { return std::min(freq / sr, 1.f); });
+        }
+
+        float next(float target)
+        {
+            value += coefficient * (target - value);
+            return value;
+        }
+
+        // Snaps to the target once close enough, after which callers can skip the per-sample
+        // ramp and use the value as a constant
+        bool settle(float target, float epsilon = 1e-6f)
+        {
+            if (std::abs(target - value) > epsilon)
+                return false;
+            value = target;
+            return true;
+        }
+
+        Smoother& operator=(float v) { value = v; return *this; }
+        operator float() const { return value; }
+    };
+}
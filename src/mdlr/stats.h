@@ -0,0 +1,75 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace mdlr
+{
+    // Callback timing against the period budget. Written by the audio thread only,
+    // with relaxed load/store pairs: nothing allocates, nothing locks.
+    struct CallbackStats
+    {
+        // Load histogram in steps of 12.5% of the budget, the last bin holds everything above 200%
+        static constexpr int BinCount = 17;
+        static constexpr double BinWidth = 0.125;
+
+        std::atomic<uint64_t> callbacks = 0;
+        std::atomic<uint64_t> overruns = 0;
+        std::atomic<float> last = 0.f;
+        std::atomic<float> peak = 0.f;
+        std::atomic<double> total = 0.;
+        std::array<std::atomic<uint64_t>, BinCount> histogram {};
+
+        void record(double elapsed, double budget)
+        {
+            const float load = float(elapsed / budget);
+            auto bump = [](std::atomic<uint64_t>& a) { a.store(a.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed); };
+
+            bump(callbacks);
+            if (load > 1.f)
+                bump(overruns);
+            bump(histogram[std::min(int(load / BinWidth), BinCount - 1)]);
+            last.store(load, std::memory_order_relaxed);
+            if (load > peak.load(std::memory_order_relaxed))
+                peak.store(load, std::memory_order_relaxed);
+            total.store(total.load(std::memory_order_relaxed) + load, std::memory_order_relaxed);
+        }
+
+        // Control thread, racy against record() like the profiler counters
+        void reset()
+        {
+            callbacks = 0;
+            overruns = 0;
+            last = 0.f;
+            peak = 0.f;
+            total = 0.;
+            for (auto& bin: histogram)
+                bin = 0;
+        }
+
+        std::string string(uint64_t xruns) const
+        {
+            const uint64_t count = callbacks.load(std::memory_order_relaxed);
+            std::string result = fmt::format("callbacks: {}, overruns: {}, xruns: {}\n", count, overruns.load(), xruns);
+            result += fmt::format("load: last {:.1f}%, avg {:.1f}%, peak {:.1f}%\n"
+                , 100. * last.load(), count ? 100. * total.load() / count : 0., 100. * peak.load());
+
+            for (int b = 0; b < BinCount; b++)
+            {
+                const uint64_t n = histogram[b].load(std::memory_order_relaxed);
+                if (n == 0)
+                    continue;
+                const int bar = count ? int(40 * n / count) : 0;
+                if (b == BinCount - 1)
+                    result += fmt::format("  >{:5.1f}% {:>10} {:#<{}}\n", 100. * b * BinWidth, n, "", bar);
+                else
+                    result += fmt::format("  <{:5.1f}% {:>10} {:#<{}}\n", 100. * (b + 1) * BinWidth, n, "", bar);
+            }
+            return result;
+        }
+    };
+}
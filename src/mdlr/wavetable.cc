@@ -0,0 +1,192 @@
+#include "mdlr/wavetable.h"
+#include "mdlr/log.h"
+
+#include <cmath>
+#include <complex>
+#include <numbers>
+
+#if defined(MDLR_USE_VORBIS)
+#include <stb_vorbis.c>
+#endif // defined(MDLR_USE_VORBIS)
+
+namespace mdlr
+{
+    using Spectrum = std::vector<std::complex<float>>;
+
+    // In-place iterative radix-2 FFT, the inverse is not scaled
+    static void fft(Spectrum& data, bool inverse)
+    {
+        const size_t n = data.size();
+        for (size_t i = 1, j = 0; i < n; i++)
+        {
+            size_t bit = n >> 1;
+            for (; j & bit; bit >>= 1)
+                j ^= bit;
+            j ^= bit;
+            if (i < j)
+                std::swap(data[i], data[j]);
+        }
+
+        for (size_t length = 2; length <= n; length <<= 1)
+        {
+            const float angle = (inverse ? 2.f : -2.f) * std::numbers::pi_v<float> / float(length);
+            const std::complex<float> step(std::cos(angle), std::sin(angle));
+            for (size_t i = 0; i < n; i += length)
+            {
+                std::complex<float> w(1.f);
+                for (size_t k = 0; k < length / 2; k++)
+                {
+                    auto even = data[i + k];
+                    auto odd = data[i + k + length / 2] * w;
+                    data[i + k] = even + odd;
+                    data[i + k + length / 2] = even - odd;
+                    w *= step;
+                }
+            }
+        }
+    }
+
+    // Writes every mip level of a frame from its spectrum, DC removed
+    static void build(Wavetable& table, int frame, const Spectrum& spectrum)
+    {
+        constexpr int Size = Wavetable::Size;
+        Spectrum bins(Size);
+        for (int level = 0; level < Wavetable::Levels; level++)
+        {
+            const int harmonics = (Size / 2) >> level;
+            std::fill(bins.begin(), bins.end(), std::complex<float>());
+            for (int k = 1; k < std::min(harmonics + 1, Size / 2); k++)
+            {
+                bins[k] = spectrum[k];
+                bins[Size - k] = spectrum[Size - k];
+            }
+            fft(bins, true);
+
+            float* out = table.cycle(frame, level);
+            for (int i = 0; i < Size; i++)
+                out[i] = bins[i].real() / Size;
+            out[Size] = out[0];
+        }
+    }
+
+    static std::unique_ptr<Wavetable> allocate(int frames)
+    {
+        auto table = std::make_unique<Wavetable>();
+        table->frames = frames;
+        table->samples.resize(size_t(frames) * Wavetable::Levels * (Wavetable::Size + 1));
+        return table;
+    }
+
+    std::unique_ptr<Wavetable> Wavetable::fromCycles(std::span<const float> cycles)
+    {
+        const int frames = int(cycles.size() / Size);
+        if (frames == 0)
+            return nullptr;
+
+        auto table = allocate(frames);
+        Spectrum spectrum(Size);
+        for (int frame = 0; frame < frames; frame++)
+        {
+            for (int i = 0; i < Size; i++)
+                spectrum[i] = cycles[size_t(frame) * Size + i];
+            fft(spectrum, false);
+            build(*table, frame, spectrum);
+        }
+        return table;
+    }
+
+    std::unique_ptr<Wavetable> Wavetable::fromHarmonics(std::span<const float> amplitudes)
+    {
+        // sin(k x) has bins -i/2 at k and +i/2 at -k, scaled by Size for the inverse transform
+        Spectrum spectrum(Size);
+        for (size_t h = 0; h < amplitudes.size() && h + 1 < Size / 2; h++)
+        {
+            const int k = int(h + 1);
+            spectrum[k] = std::complex<float>(0.f, -0.5f * Size * amplitudes[h]);
+            spectrum[Size - k] = std::complex<float>(0.f, 0.5f * Size * amplitudes[h]);
+        }
+
+        auto table = allocate(1);
+        build(*table, 0, spectrum);
+        return table;
+    }
+
+    WavetableBank& WavetableBank::instance()
+    {
+        static WavetableBank bank;
+        static std::once_flag builtins;
+        std::call_once(builtins, []
+        {
+            constexpr int count = Wavetable::Size / 2;
+            constexpr float pi = std::numbers::pi_v<float>;
+            std::vector<float> sine(1, 1.f), saw(count), square(count), triangle(count);
+            for (int k = 1; k <= count; k++)
+            {
+                saw[k - 1] = (k % 2 ? 2.f : -2.f) / (pi * k);
+                square[k - 1] = k % 2 ? 4.f / (pi * k) : 0.f;
+                triangle[k - 1] = k % 2 ? ((k / 2) % 2 ? -8.f : 8.f) / (pi * pi * k * k) : 0.f;
+            }
+            bank.add("sine", Wavetable::fromHarmonics(sine));
+            bank.add("saw", Wavetable::fromHarmonics(saw));
+            bank.add("square", Wavetable::fromHarmonics(square));
+            bank.add("triangle", Wavetable::fromHarmonics(triangle));
+        });
+        return bank;
+    }
+
+    const Wavetable* WavetableBank::find(std::string_view name)
+    {
+        std::scoped_lock lock(mutex);
+        auto it = tables.find(std::string(name));
+        return it != tables.end() ? it->second.get() : nullptr;
+    }
+
+    const Wavetable* WavetableBank::add(std::string_view name, std::unique_ptr<Wavetable> table)
+    {
+        if (!table)
+            return nullptr;
+        std::scoped_lock lock(mutex);
+        auto& slot = tables[std::string(name)];
+        if (!slot)
+            slot = std::move(table);
+        return slot.get();
+    }
+
+    const Wavetable* WavetableBank::load(std::string_view path)
+    {
+        if (auto table = find(path))
+            return table;
+
+    #if defined(MDLR_USE_VORBIS)
+        int channels = 0;
+        int samplerate = 0;
+        short* decoded = nullptr;
+        const int length = stb_vorbis_decode_filename(std::string(path).c_str(), &channels, &samplerate, &decoded);
+        if (length <= 0 || channels <= 0)
+        {
+            trace(LogCategory::engine, "Wavetable: cannot decode {}", path);
+            return nullptr;
+        }
+
+        std::vector<float> cycles(length);
+        for (int i = 0; i < length; i++)
+        {
+            float sum = 0.f;
+            for (int c = 0; c < channels; c++)
+                sum += decoded[i * channels + c];
+            cycles[i] = sum / (32768.f * channels);
+        }
+        free(decoded);
+
+        if (length < Wavetable::Size)
+        {
+            trace(LogCategory::engine, "Wavetable: {} is shorter than one {} samples cycle", path, Wavetable::Size);
+            return nullptr;
+        }
+        return add(path, Wavetable::fromCycles(cycles));
+    #else
+        trace(LogCategory::engine, "Wavetable: cannot load {}, built without MDLR_USE_VORBIS", path);
+        return nullptr;
+    #endif // defined(MDLR_USE_VORBIS)
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace mdlr
+{
+    // Single-cycle waveforms, band-limited once per octave. Level k keeps the harmonics
+    // below Size / 2^(k+1), so it plays alias-free up to a fundamental of samplerate / 2^(11-k).
+    // A table may hold several frames (cycles) to morph between.
+    struct Wavetable
+    {
+        static constexpr int Size = 2048;
+        static constexpr int Levels = 11;
+
+        int frames = 0;
+
+        // [frame][level][Size + 1], the last sample repeats the first for interpolation
+        std::vector<float> samples;
+
+        const float* cycle(int frame, int level) const
+        {
+            return samples.data() + (size_t(frame) * Levels + level) * (Size + 1);
+        }
+        float* cycle(int frame, int level)
+        {
+            return samples.data() + (size_t(frame) * Levels + level) * (Size + 1);
+        }
+
+        // Mip level for a phase increment in cycles per sample
+        static int level(float increment)
+        {
+            const float x = std::max(increment * Size, 1.f);
+            const uint32_t bits = std::bit_cast<uint32_t>(x);
+            const int octave = int(bits >> 23) - 127 + ((bits & 0x7FFFFF) != 0);
+            return std::min(octave, Levels - 1);
+        }
+
+        float sample(int frame, int level, float phase) const
+        {
+            const float* data = cycle(frame, level);
+            const float position = phase * Size;
+            const int index = int(position);
+            const float frac = position - float(index);
+            return data[index] + frac * (data[index + 1] - data[index]);
+        }
+
+        // From consecutive cycles of Size samples each
+        static std::unique_ptr<Wavetable> fromCycles(std::span<const float> cycles);
+
+        // From sine amplitudes of the harmonics, starting with the fundamental
+        static std::unique_ptr<Wavetable> fromHarmonics(std::span<const float> amplitudes);
+    };
+
+    // Process-wide table store. Tables are built or loaded on the control thread and
+    // never freed, so the audio thread can hold plain pointers to them.
+    struct WavetableBank
+    {
+        std::mutex mutex;
+        std::unordered_map<std::string, std::unique_ptr<Wavetable>> tables;
+
+        // Built-in "sine", "saw", "square" and "triangle" are created on first use
+        static WavetableBank& instance();
+
+        const Wavetable* find(std::string_view name);
+        const Wavetable* add(std::string_view name, std::unique_ptr<Wavetable> table);
+
+        // Decodes an ogg file (mixed down to mono) as consecutive cycles of Wavetable::Size
+        // samples, needs MDLR_USE_VORBIS. Tables are cached by path.
+        const Wavetable* load(std::string_view path);
+
+        // A known table name, else a file to load
+        const Wavetable* resolve(std::string_view name) { auto table = find(name); return table ? table : load(name); }
+    };
+}
@@ -0,0 +1,316 @@
+#include "mdlr/engine.h"
+#include "mdlr/modules/oversampler.h"
+
+#include "testing.h"
+
+using namespace mdlr;
+
+// Outputs a fixed value and reports its destruction
+struct Constant: Module
+{
+    Signal value;
+    bool* destroyed;
+    Parameter* gain;
+    Parameter* label;
+
+    Constant(Signal value, bool* destroyed = nullptr): value(value), destroyed(destroyed)
+    {
+        outs = {
+            { "output" }
+        };
+        gain = &addParameter("gain", 1.f).range(0.f, 4.f);
+        label = &addParameter("label", std::string("constant"));
+    }
+    ~Constant()
+    {
+        if (destroyed)
+            *destroyed = true;
+    }
+
+    virtual void process(float samplerate) override
+    {
+        outs[0].signal = value * gain->get<float>();
+    }
+};
+
+struct Fixture
+{
+    std::vector<float> unused;
+    std::vector<float> outs;
+    Engine engine;
+
+    Fixture()
+    {
+        engine.init({
+            .capture = { .channels = 0 },
+            .playback = { .channels = 2 },
+            .samplerate = 48000,
+            .buffersize = 32,
+            .backend = DriverBackend::Offline,
+            .offline = { .buffer = &unused },
+        });
+        outs.resize(64);
+    }
+
+    float run(int channel, int frame = 0)
+    {
+        engine.callback(nullptr, outs.data(), 32);
+        return outs[frame * 2 + channel];
+    }
+};
+
+TEST_CASE(edits_wait_for_commit)
+{
+    Fixture fixture;
+    auto& system = fixture.engine.system;
+    auto& a = system.create<Constant>("a", 1.f);
+    a.outs[0].connect(system.outs[0]);
+    fixture.engine.start();
+    CHECK(fixture.run(0) == 1.f);
+
+    auto& b = system.create<Constant>("b", 2.f);
+    b.outs[0].connect(system.outs[1]);
+    CHECK(fixture.run(1) == 0.f);
+    CHECK(system.plan.steps.size() == 1);
+
+    REQUIRE(fixture.engine.commit());
+    CHECK(fixture.run(1) == 2.f);
+    CHECK(fixture.run(0) == 1.f);
+    CHECK(system.plan.steps.size() == 2);
+}
+
+TEST_CASE(removed_modules_outlive_the_plan)
+{
+    Fixture fixture;
+    auto& system = fixture.engine.system;
+    bool destroyed = false;
+    auto& a = system.create<Constant>("a", 1.f, &destroyed);
+    a.outs[0].connect(system.outs[0]);
+    fixture.engine.start();
+    CHECK(fixture.run(0) == 1.f);
+
+    std::vector<std::unique_ptr<Module>> removed;
+    removed.push_back(system.remove(a));
+    CHECK(system.modules.empty());
+    CHECK(system.outs[0].sources.empty());
+    REQUIRE(fixture.engine.commit(std::move(removed)));
+    CHECK(!destroyed);
+
+    // Freed on the control thread once the audio thread let go of the old plan
+    CHECK(fixture.run(0) == 0.f);
+    CHECK(!destroyed);
+    fixture.engine.update();
+    CHECK(destroyed);
+}
+
+TEST_CASE(crossfade)
+{
+    Fixture fixture;
+    auto& system = fixture.engine.system;
+    bool destroyed = false;
+    auto& a = system.create<Constant>("a", 1.f, &destroyed);
+    a.outs[0].connect(system.outs[0]);
+    fixture.engine.start();
+    CHECK(fixture.run(0) == 1.f);
+
+    auto removed = system.clear();
+    auto& b = system.create<Constant>("b", 3.f);
+    b.outs[0].connect(system.outs[0]);
+    REQUIRE(fixture.engine.commit(std::move(removed), 64));
+
+    // Linear from the old set to the new one over two blocks
+    fixture.run(0);
+    CHECK(std::abs(fixture.outs[0] - (1.f + 2.f / 64.f)) < 1e-5f);
+    CHECK(std::abs(fixture.outs[31 * 2] - 2.f) < 1e-5f);
+    fixture.run(0);
+    CHECK(std::abs(fixture.outs[31 * 2] - 3.f) < 1e-5f);
+    fixture.engine.update();
+    CHECK(destroyed);
+    CHECK(fixture.run(0) == 3.f);
+}
+
+TEST_CASE(parameters)
+{
+    Fixture fixture;
+    auto& system = fixture.engine.system;
+    auto& a = system.create<Constant>("a", 1.f);
+    a.outs[0].connect(system.outs[0]);
+    fixture.engine.start();
+
+    // Typed, clamped, and counted
+    uint32_t seen = a.gain->revision();
+    CHECK(!a.gain->changed(seen));
+    CHECK(!a.gain->set(2));
+    CHECK(a.gain->set(8.f));
+    CHECK(a.gain->get<float>() == 4.f);
+    CHECK(a.gain->changed(seen));
+    CHECK(!a.gain->changed(seen));
+    CHECK(std::get<float>(ParameterValue(*a.gain)) == 4.f);
+
+    // Applied between blocks, the replaced string comes back with the command
+    REQUIRE(fixture.engine.setParameter(*a.gain, 0.5f));
+    REQUIRE(fixture.engine.setParameter(*a.label, std::string("renamed")));
+    CHECK(a.label->string() == "constant");
+    CHECK(fixture.run(0) == 0.5f);
+    CHECK(a.label->string() == "renamed");
+    Command command;
+    REQUIRE(fixture.engine.retired.pop(command));
+    REQUIRE(fixture.engine.retired.pop(command));
+    CHECK(std::get<std::string>(command.value) == "constant");
+}
+
+// Passes its input through, so automated inputs can be read back
+struct Follower: Module
+{
+    Follower()
+    {
+        ins = {
+            { "input" }
+        };
+        outs = {
+            { "output" }
+        };
+    }
+
+    virtual void process(float samplerate) override
+    {
+        outs[0].signal = ins[0].signal;
+    }
+};
+
+TEST_CASE(automation)
+{
+    Fixture fixture;
+    auto& engine = fixture.engine;
+    auto& system = engine.system;
+    auto& follower = system.create<Follower>("follower");
+    auto& a = system.create<Constant>("a", 1.f);
+    follower.outs[0].connect(system.outs[0]);
+    a.outs[0].connect(system.outs[1]);
+    follower.ins[0] = 1.f;
+    engine.start();
+
+    auto& input = engine.automation.attach(follower.ins[0]);
+    Lane* gain = engine.automation.attach(*a.gain);
+    REQUIRE(gain != nullptr);
+    REQUIRE(engine.commit());
+    CHECK(fixture.run(0) == 1.f);
+
+    // Linear over two blocks, sample accurate
+    REQUIRE(engine.ramp(input, 3.f, 64));
+    REQUIRE(engine.ramp(*gain, 2.f, 64));
+    fixture.run(0);
+    CHECK(std::abs(fixture.outs[0] - (1.f + 2.f / 64.f)) < 1e-5f);
+    CHECK(std::abs(fixture.outs[31 * 2] - 2.f) < 1e-5f);
+    CHECK(std::abs(fixture.outs[31 * 2 + 1] - 1.5f) < 1e-5f);
+    fixture.run(0);
+    CHECK(std::abs(fixture.outs[31 * 2] - 3.f) < 1e-5f);
+    CHECK(a.gain->get<float>() == 2.f);
+    CHECK(fixture.run(0) == 3.f);
+    CHECK(fixture.outs[31 * 2] == 3.f);
+    CHECK(!input.running);
+
+    // Breakpoints: an exponential segment, then a jump held until its point
+    const Breakpoint curve[] = {
+        { .offset = 32, .value = 12.f, .shape = Breakpoint::Shape::exponential },
+        { .offset = 40, .value = 5.f, .shape = Breakpoint::Shape::step },
+    };
+    REQUIRE(engine.automate(input, curve));
+    fixture.run(0);
+    CHECK(std::abs(fixture.outs[15 * 2] - 6.f) < 1e-3f);
+    CHECK(std::abs(fixture.outs[31 * 2] - 12.f) < 1e-3f);
+    fixture.run(0);
+    CHECK(fixture.outs[6 * 2] == 12.f);
+    CHECK(fixture.outs[7 * 2] == 5.f);
+    CHECK(fixture.outs[31 * 2] == 5.f);
+
+    // Detached lanes stop, unplug their input with the next commit and leave the parameter alone
+    REQUIRE(engine.ramp(input, 7.f, 64));
+    REQUIRE(engine.ramp(*gain, 3.f, 64));
+    REQUIRE(engine.detach(input));
+    REQUIRE(engine.detach(*gain));
+    CHECK(follower.ins[0].sources.empty());
+    fixture.run(0);
+    CHECK(fixture.outs[31 * 2] == 5.f);
+    CHECK(a.gain->get<float>() == 2.f);
+    REQUIRE(engine.commit());
+    CHECK(fixture.run(0) == 5.f);       // the unplugged input holds the last value it got
+    CHECK(!input.running);
+    CHECK(gain->parameter == nullptr);
+
+    // Strings, and parameters that change through their module's prepare/apply, are refused
+    Constant b(0.f);
+    auto& size = b.addParameter("size", 4).staging();
+    CHECK(engine.automation.attach(*a.label) == nullptr);
+    CHECK(engine.automation.attach(size) == nullptr);
+}
+
+TEST_CASE(owned_groups_are_live)
+{
+    // A group kept inside another module gets its plan through commit too
+    Fixture fixture;
+    auto& system = fixture.engine.system;
+    auto inner = std::make_unique<Group>();
+    auto& group = *inner;
+    auto& a = group.create<Constant>("a", 1.f);
+    a.outs[0].connect(group.addOutput("output"));
+    auto& ovs = system.create<Oversampler>("ovs", 2, std::move(inner));
+    ovs.outs[0].connect(system.outs[0]);
+    fixture.engine.start();
+    fixture.run(0);
+    CHECK(group.plan.live);
+    CHECK(group.plan.steps.size() == 1);
+
+    auto& b = group.create<Constant>("b", 2.f);
+    b.outs[0].connect(group.outs[0]);
+    fixture.run(0);
+    CHECK(group.plan.steps.size() == 1);
+    REQUIRE(fixture.engine.commit());
+    fixture.run(0);
+    CHECK(group.plan.steps.size() == 2);
+}
+
+TEST_CASE(full_retired_queue)
+{
+    Fixture fixture;
+    auto& engine = fixture.engine;
+    auto& system = engine.system;
+    bool destroyed = false;
+    auto& a = system.create<Constant>("a", 1.f, &destroyed);
+    a.outs[0].connect(system.outs[0]);
+    engine.start();
+
+    // Commands wait in their queue until there is room to hand them back
+    const auto fill = [&] { while (engine.retired.size() < engine.retired.capacity()) engine.retired.push({}); };
+    fill();
+    Command command { .type = Command::Type::set_signal, .slot = &system.outs[1], .signal = 5.f };
+    REQUIRE(engine.post(std::move(command)));
+    CHECK(fixture.run(1) == 0.f);
+    engine.update();
+    CHECK(fixture.run(1) == 5.f);
+
+    // A finished crossfade keeps the replaced graph until it can be handed back
+    auto removed = system.clear();
+    auto& b = system.create<Constant>("b", 3.f);
+    b.outs[0].connect(system.outs[0]);
+    REQUIRE(engine.commit(std::move(removed), 64));
+    fixture.run(0);
+    fill();
+    fixture.run(0);
+    CHECK(std::abs(fixture.outs[31 * 2] - 3.f) < 1e-5f);
+    engine.update();
+    CHECK(!destroyed);
+    CHECK(fixture.run(0) == 3.f);
+    engine.update();
+    CHECK(destroyed);
+}
+
+TEST_ENTRY({
+    RUN_TEST(test_edits_wait_for_commit);
+    RUN_TEST(test_removed_modules_outlive_the_plan);
+    RUN_TEST(test_crossfade);
+    RUN_TEST(test_owned_groups_are_live);
+    RUN_TEST(test_full_retired_queue);
+    RUN_TEST(test_parameters);
+    RUN_TEST(test_automation);
+})
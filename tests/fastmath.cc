@@ -0,0 +1,128 @@
+#include "mdlr/fastmath.h"
+
+#include "testing.h"
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+using namespace mdlr;
+
+// Evenly spaced samples of [lo, hi]
+static std::vector<float> sweep(float lo, float hi, int count = 1 << 16)
+{
+    std::vector<float> x(count);
+    for (int i = 0; i < count; i++)
+        x[i] = lo + (hi - lo) * float(i) / float(count - 1);
+    return x;
+}
+
+// Max error of a batch function against libm, relative or absolute
+template <typename Batch, typename Reference>
+static double error(const std::vector<float>& x, Batch batch, Reference reference, bool relative)
+{
+    std::vector<float> out(x.size());
+    batch(x, out);
+    double worst = 0.;
+    for (size_t i = 0; i < x.size(); i++)
+    {
+        const double exact = reference(double(x[i]));
+        const double e = std::abs(out[i] - exact) / (relative ? std::abs(exact) : 1.);
+        worst = std::max(worst, e);
+    }
+    return worst;
+}
+
+// Nanoseconds per value of a batch function and of the libm loop it replaces
+template <typename Batch, typename Reference>
+static void timing(const char* name, const std::vector<float>& x, Batch batch, Reference reference)
+{
+    using clock = std::chrono::steady_clock;
+    std::vector<float> out(x.size());
+    const int rounds = 32;
+
+    auto start = clock::now();
+    for (int r = 0; r < rounds; r++)
+        batch(x, out);
+    const double fast = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+    start = clock::now();
+    for (int r = 0; r < rounds; r++)
+        for (size_t i = 0; i < x.size(); i++)
+            out[i] = reference(x[i]);
+    const double libm = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+    const double n = double(rounds) * x.size();
+    fmt::println("    {:<6} {:6.2f} ns  libm {:6.2f} ns  x{:.1f}", name, fast / n, libm / n, libm / fast);
+}
+
+TEST_CASE(accuracy)
+{
+    auto exp2 = [](std::span<const float> x, std::span<float> out) { fastmath::exp2(x, out); };
+    auto log2 = [](std::span<const float> x, std::span<float> out) { fastmath::log2(x, out); };
+    auto exp = [](std::span<const float> x, std::span<float> out) { fastmath::exp(x, out); };
+    auto tanh = [](std::span<const float> x, std::span<float> out) { fastmath::tanh(x, out); };
+    auto sin = [](std::span<const float> x, std::span<float> out) { fastmath::sin(x, out); };
+    auto cos = [](std::span<const float> x, std::span<float> out) { fastmath::cos(x, out); };
+    auto pow = [](std::span<const float> x, std::span<float> out) { fastmath::pow(x, 2.5f, out); };
+    auto mtof = [](std::span<const float> x, std::span<float> out) { fastmath::mtof(x, out); };
+
+    auto exactExp2 = [](double x) { return std::exp2(x); };
+    auto exactExp = [](double x) { return std::exp(x); };
+    auto exactLog2 = [](double x) { return std::log2(x); };
+    auto exactPow = [](double x) { return std::pow(x, 2.5); };
+    auto exactTanh = [](double x) { return std::tanh(x); };
+    auto exactSin = [](double x) { return std::sin(x); };
+    auto exactCos = [](double x) { return std::cos(x); };
+    auto exactMtof = [](double x) { return 440. * std::exp2((x - 69.) / 12.); };
+
+    CHECK(error(sweep(-126.f, 126.f), exp2, exactExp2, true) < 2e-7);
+    CHECK(error(sweep(-1.f, 1.f), exp, exactExp, true) < 3e-7);
+    CHECK(error(sweep(-20.f, 20.f), exp, exactExp, true) < 2e-6);
+    CHECK(error(sweep(0.01f, 4.f), log2, exactLog2, false) < 3e-7);
+    CHECK(error(sweep(1e-30f, 1e30f), log2, exactLog2, false) < 4e-6);
+    CHECK(error(sweep(0.01f, 100.f), pow, exactPow, true) < 2e-6);
+    CHECK(error(sweep(-12.f, 12.f), tanh, exactTanh, false) < 5e-7);
+    CHECK(error(sweep(-3.14159f, 3.14159f), sin, exactSin, false) < 5e-7);
+    CHECK(error(sweep(-3.14159f, 3.14159f), cos, exactCos, false) < 5e-7);
+    CHECK(error(sweep(-100.f, 100.f), sin, exactSin, false) < 2e-5);
+    CHECK(error(sweep(0.f, 127.f), mtof, exactMtof, true) < 6e-7);
+}
+
+TEST_CASE(scalar_matches_batch)
+{
+    auto x = sweep(-4.f, 4.f, 1024);
+    std::vector<float> out(x.size());
+    fastmath::tanh(x, out);
+
+    // Up to FMA contraction differences in the dispatched kernel
+    bool same = true;
+    for (size_t i = 0; i < x.size(); i++)
+        same = same && std::abs(out[i] - fastmath::tanh(x[i])) < 1e-6f;
+    CHECK(same);
+
+    // In place
+    fastmath::exp2(x, x);
+    CHECK(std::abs(x[0] - 0.0625f) < 1e-7f);
+    CHECK(std::abs(x.back() - 16.f) < 1e-5f);
+}
+
+TEST_CASE(performance)
+{
+    auto x = sweep(-4.f, 4.f, 4096);
+    auto positive = sweep(0.01f, 100.f, 4096);
+    fmt::println("  per value, fastmath batch vs libm loop:");
+    timing("exp2", x, [](auto x, auto out) { fastmath::exp2(x, out); }, [](float x) { return std::exp2(x); });
+    timing("exp", x, [](auto x, auto out) { fastmath::exp(x, out); }, [](float x) { return std::exp(x); });
+    timing("log2", positive, [](auto x, auto out) { fastmath::log2(x, out); }, [](float x) { return std::log2(x); });
+    timing("pow", positive, [](auto x, auto out) { fastmath::pow(x, 2.5f, out); }, [](float x) { return std::pow(x, 2.5f); });
+    timing("tanh", x, [](auto x, auto out) { fastmath::tanh(x, out); }, [](float x) { return std::tanh(x); });
+    timing("sin", x, [](auto x, auto out) { fastmath::sin(x, out); }, [](float x) { return std::sin(x); });
+    timing("mtof", x, [](auto x, auto out) { fastmath::mtof(x, out); }, [](float x) { return 440.f * std::pow(2.f, (x - 69.f) / 12.f); });
+}
+
+TEST_ENTRY({
+    RUN_TEST(test_accuracy);
+    RUN_TEST(test_scalar_matches_batch);
+    RUN_TEST(test_performance);
+})
@@ -0,0 +1,248 @@
+#include "mdlr/module.h"
+#include "mdlr/modules/core.h"
+#include "mdlr/scheduler.h"
+
+#include "testing.h"
+
+using namespace mdlr;
+
+static std::string order(const Group& group)
+{
+    std::string result;
+    for (const auto& step: group.plan.steps)
+        result += step.module->name;
+    return result;
+}
+
+TEST_CASE(topological_order)
+{
+    Group group;
+    auto& c = group.create<Attenuator>("c");
+    auto& b = group.create<Attenuator>("b");
+    auto& a = group.create<Attenuator>("a");
+    a.outs[Attenuator::slot_output].connect(b.ins[Attenuator::slot_input]);
+    b.outs[Attenuator::slot_output].connect(c.ins[Attenuator::slot_input]);
+
+    group.prepare(16);
+    group.compile();
+    CHECK(order(group) == "abc");
+    CHECK(group.plan.delays.empty());
+}
+
+TEST_CASE(feedback_cycle)
+{
+    Group group;
+    auto& a = group.create<Attenuator>("a");
+    auto& b = group.create<Attenuator>("b");
+    a.outs[Attenuator::slot_output].connect(b.ins[Attenuator::slot_input]);
+    b.outs[Attenuator::slot_output].connect(a.ins[Attenuator::slot_input]);
+
+    group.prepare(16);
+    group.compile();
+    CHECK(order(group) == "ab");
+    REQUIRE(group.plan.delays.size() == 1);
+    CHECK(group.plan.delays[0].source == &b.outs[Attenuator::slot_output]);
+}
+
+TEST_CASE(recompile_on_edit)
+{
+    Group group;
+    auto& a = group.create<Attenuator>("a");
+    auto& b = group.create<Attenuator>("b");
+    group.prepare(16);
+    group.processBlock(48000.f, 16);
+    CHECK(order(group) == "ab");
+
+    b.outs[Attenuator::slot_output].connect(a.ins[Attenuator::slot_input]);
+    group.processBlock(48000.f, 16);
+    CHECK(order(group) == "ba");
+}
+
+TEST_CASE(pull_wires)
+{
+    Group group;
+    auto& a = group.create<Attenuator>("a");
+    auto& b = group.create<Attenuator>("b");
+    auto& inner = group.create<Group>("inner");
+    auto& c = inner.create<Attenuator>("c");
+    auto& in = inner.addInput("input");
+    auto& out = inner.addOutput("output");
+    in.connect(c.ins[Attenuator::slot_input]);
+    c.outs[Attenuator::slot_output].connect(out);
+
+    for (auto m: { &a, &b, &c })
+    {
+        m->gain = 1.f;
+        m->ins[Attenuator::slot_gain] = 1.f;
+    }
+    a.ins[Attenuator::slot_input] = 0.25f;
+    b.ins[Attenuator::slot_input] = 0.5f;
+    a.outs[Attenuator::slot_output].connect(in);
+    b.outs[Attenuator::slot_output].connect(in);
+
+    group.prepare(16);
+    group.processBlock(48000.f, 16);
+    CHECK(in.data == in.buffer.data());
+    CHECK(c.ins[Attenuator::slot_input].data == in.data);
+    CHECK(out.data == c.outs[Attenuator::slot_output].data);
+    CHECK(out.data[15] == 0.75f);
+}
+
+TEST_CASE(control_rate)
+{
+    Group group;
+    auto& a = group.create<Attenuator>("a");
+    auto& b = group.create<Attenuator>("b");
+    auto& mix = group.create<Mixer8>("mix");
+    for (auto m: { &a, &b })
+        m->ins[Attenuator::slot_gain] = 1.f;
+    a.ins[Attenuator::slot_input] = 0.25f;
+    b.ins[Attenuator::slot_input] = 0.5f;
+    mix.ins[Mixer8::slot_in0] = 1.f;
+    a.outs[Attenuator::slot_output].connect(mix.ins[Mixer8::slot_volume0]);
+    b.outs[Attenuator::slot_output].connect(mix.ins[Mixer8::slot_volume0]);
+
+    // Interpolated: a ramp from the previous block's value, then a constant block
+    auto& volume = mix.ins[Mixer8::slot_volume0];
+    group.prepare(16);
+    group.processBlock(48000.f, 16);
+    CHECK(volume.signal == 0.75f);
+    CHECK(volume.data[0] == 0.75f / 16.f);
+    CHECK(volume.data[15] == 0.75f);
+    group.processBlock(48000.f, 16);
+    CHECK(volume.data[0] == 0.75f);
+
+    // Held: the new value over the whole block
+    volume.interpolate = false;
+    a.ins[Attenuator::slot_input] = 0.f;
+    a.gain = 0.f;
+    group.processBlock(48000.f, 16);
+    CHECK(volume.data[0] == 0.5f);
+    CHECK(mix.outs[Mixer8::slot_output].data[0] == 0.5f);
+}
+
+TEST_CASE(partitions)
+{
+    Group group;
+    auto& a = group.create<Attenuator>("a");
+    auto& b = group.create<Attenuator>("b");
+    auto& c = group.create<Attenuator>("c");
+    auto& d = group.create<Attenuator>("d");
+    auto& e = group.create<Attenuator>("e");
+    a.outs[Attenuator::slot_output].connect(b.ins[Attenuator::slot_input]);
+    a.outs[Attenuator::slot_output].connect(c.ins[Attenuator::slot_input]);
+    d.outs[Attenuator::slot_output].connect(e.ins[Attenuator::slot_input]);
+
+    // a fans out so b and c get their own partitions, d -> e is a single chain
+    group.prepare(16);
+    group.compile();
+    CHECK(group.plan.partitions.size() == 4);
+    REQUIRE(group.plan.waves.size() == 3);
+    CHECK(group.plan.waves[1] == 2);
+    CHECK(order(group) == "adebc");
+}
+
+TEST_CASE(scheduler_matches_serial)
+{
+    auto build = [](Group& group)
+    {
+        auto& out = group.addOutput("output");
+        auto& mix = group.create<Mixer8>("mix");
+        for (int i = 0; i < 8; i++)
+        {
+            auto& osc = group.create<Oscillator>(fmt::format("osc{}", i));
+            auto& vca = group.create<Attenuator>(fmt::format("vca{}", i));
+            osc.ins[Oscillator::slot_frequency] = 100.f * (i + 1);
+            osc.outs[Oscillator::slot_output].connect(vca.ins[Attenuator::slot_input]);
+            vca.outs[Attenuator::slot_output].connect(mix.ins[Mixer8::slot_in0 + i]);
+            mix.ins[Mixer8::slot_volume0 + i] = 0.1f;
+        }
+        mix.outs[Mixer8::slot_output].connect(out);
+        group.prepare(64);
+    };
+
+    Group serial, parallel;
+    Scheduler scheduler(3);
+    build(serial);
+    build(parallel);
+    parallel.scheduler = &scheduler;
+
+    bool same = true;
+    for (int b = 0; b < 32; b++)
+    {
+        serial.processBlock(48000.f, 64);
+        parallel.processBlock(48000.f, 64);
+        for (int f = 0; f < 64; f++)
+            same = same && serial.outs[0].data[f] == parallel.outs[0].data[f];
+    }
+    CHECK(parallel.plan.partitions.size() == 9);
+    CHECK(same);
+}
+
+TEST_CASE(scheduler_shutdown)
+{
+    // Workers that only start once the scheduler is being destroyed must still exit
+    Group group;
+    auto& mix = group.create<Mixer8>("mix");
+    for (int i = 0; i < 8; i++)
+        group.create<Oscillator>(fmt::format("osc{}", i)).outs[Oscillator::slot_output].connect(mix.ins[Mixer8::slot_in0 + i]);
+    group.prepare(64);
+
+    for (int run = 0; run < 200; run++)
+    {
+        Scheduler idle(4);
+        Scheduler scheduler(4);
+        group.scheduler = &scheduler;
+        for (int b = 0; b < run % 4; b++)
+            group.processBlock(48000.f, 64);
+        group.scheduler = nullptr;
+    }
+    CHECK(group.plan.partitions.size() == 9);
+}
+
+TEST_CASE(path_index)
+{
+    Group system;
+    auto& acid = system.create<Group>("acid");
+    auto& clock = acid.addInput("clock");
+    auto& amp = acid.create<Attenuator>("amp");
+    auto& osc = acid.create<Oscillator>("osc");
+
+    CHECK(system.findModule("acid.amp") == &amp);
+    CHECK(system.findInput("acid.clock") == &clock);
+    CHECK(system.findInput("acid.amp.gain") == &amp.ins[Attenuator::slot_gain]);
+    CHECK(system.findOutput("acid.amp.output") == &amp.outs[Attenuator::slot_output]);
+    CHECK(system.findParameter("acid.osc.accuracy") == osc.findParameter("accuracy"));
+    CHECK(system.findInput("acid.amp.output") == nullptr);
+    CHECK(system.findModule("acid.amp.gain") == nullptr);
+    CHECK(system.findInput("acid.vca.gain") == nullptr);
+
+    // Many at once, unknown paths come back empty
+    std::string_view paths[] = { "acid.osc.frequency", "acid.nope", "acid" };
+    Handle handles[3];
+    system.resolve(paths, handles);
+    CHECK(handles[0].input == &osc.ins[Oscillator::slot_frequency]);
+    CHECK(!handles[1]);
+    CHECK(handles[2].module == &acid);
+
+    // Kept up to date with the layout
+    auto& vca = acid.create<Attenuator>("vca");
+    auto& reset = acid.addInput("reset");
+    CHECK(system.findInput("acid.vca.gain") == &vca.ins[Attenuator::slot_gain]);
+    CHECK(system.findInput("acid.reset") == &reset);
+    auto removed = acid.remove(amp);
+    CHECK(system.findModule("acid.amp") == nullptr);
+    CHECK(system.findModule("acid.vca") == &vca);
+}
+
+TEST_ENTRY({
+    RUN_TEST(test_topological_order);
+    RUN_TEST(test_feedback_cycle);
+    RUN_TEST(test_recompile_on_edit);
+    RUN_TEST(test_pull_wires);
+    RUN_TEST(test_control_rate);
+    RUN_TEST(test_partitions);
+    RUN_TEST(test_scheduler_matches_serial);
+    RUN_TEST(test_scheduler_shutdown);
+    RUN_TEST(test_path_index);
+})
@@ -0,0 +1,69 @@
+#include "mdlr/module.h"
+#include "mdlr/modules/midi.h"
+
+#include "testing.h"
+
+#include <algorithm>
+
+using namespace mdlr;
+
+static MidiEvent note(int64_t time, bool on, uint8_t key)
+{
+    return { .time = time, .bytes = { uint8_t(on ? 0x90 : 0x80), key, 100 } };
+}
+
+TEST_CASE(gate_within_one_block)
+{
+    MidiGate128 gate;
+    Slot reader;
+    gate.outs[60].connect(reader);
+    gate.prepare(48);
+
+    // On after 100us and off after 300us of a 1ms block at 48kHz
+    const int64_t start = MidiEventQueue::now() - 1000000;
+    gate.queue.blocktime = start;
+    gate.queue.events.push(note(start + 100000, true, 60));
+    gate.queue.events.push(note(start + 300000, false, 60));
+    gate.processBlock(48000.f, 48);
+    const auto& buffer = gate.outs[60].buffer;
+    CHECK(buffer[3] == 0.f);
+    CHECK(buffer[4] == 1.f);
+    CHECK(buffer[13] == 1.f);
+    CHECK(buffer[14] == 0.f);
+    CHECK(buffer[47] == 0.f);
+
+    // The next block without events is low throughout
+    gate.processBlock(48000.f, 48);
+    const bool low = std::all_of(buffer.begin(), buffer.end(), [](float v) { return v == 0.f; });
+    CHECK(low);
+}
+
+TEST_CASE(events_follow_the_frame_clock)
+{
+    // A 48 frame period at 48kHz run as three sub-blocks of 16 frames
+    const int64_t period = 1000000;
+    Module::clock = { .previous = period, .period = 2 * period, .start = 4800, .frame = 4800, .frames = 48 };
+
+    MidiEventQueue queue;
+    queue.events.push(note(period + 500000, true, 60));       // frame 24 of the period
+    std::vector<std::pair<int, int>> drained;
+    for (int b = 0; b < 3; b++)
+    {
+        Module::clock.frame = 4800 + 16 * b;
+        queue.drain(48000.f, 16, [&](int offset, const MidiEvent&) { drained.push_back({ b, offset }); });
+    }
+    REQUIRE(drained.size() == 1);
+    CHECK(drained[0].first == 1);
+    CHECK(drained[0].second == 8);
+
+    // Events arriving during the current period wait for the next one
+    queue.events.push(note(2 * period + 1, true, 61));
+    queue.drain(48000.f, 16, [&](int offset, const MidiEvent&) { drained.push_back({ 3, offset }); });
+    CHECK(drained.size() == 1);
+    Module::clock = {};
+}
+
+TEST_ENTRY({
+    RUN_TEST(test_gate_within_one_block);
+    RUN_TEST(test_events_follow_the_frame_clock);
+})
@@ -0,0 +1,115 @@
+#include "mdlr/module.h"
+#include "mdlr/modules/core.h"
+#include "mdlr/modules/oversampler.h"
+
+#include "testing.h"
+
+#include <cmath>
+#include <numbers>
+
+using namespace mdlr;
+
+// Renders blocks of a sine through the first input and output of a module
+static std::pair<std::vector<float>, std::vector<float>> render(Module& module, float frequency, int blocks)
+{
+    Oscillator osc;
+    osc.ins[Oscillator::slot_frequency] = frequency;
+    osc.outs[Oscillator::slot_output].connect(module.ins[0]);
+    osc.prepare(64);
+    module.prepare(64);
+
+    std::vector<float> input, output;
+    for (int b = 0; b < blocks; b++)
+    {
+        osc.processBlock(48000.f, 64);
+        module.ins[0].data = osc.outs[0].data;
+        module.ins[0].constant = false;
+        module.processBlock(48000.f, 64);
+        input.insert(input.end(), osc.outs[0].data, osc.outs[0].data + 64);
+        output.insert(output.end(), module.outs[0].data, module.outs[0].data + 64);
+    }
+    return { input, output };
+}
+
+// Magnitude of one frequency over a signal, in dB
+static float magnitude(const std::vector<float>& signal, float frequency)
+{
+    double re = 0., im = 0.;
+    for (size_t n = 0; n < signal.size(); n++)
+    {
+        re += signal[n] * std::cos(2. * std::numbers::pi * frequency * n / 48000.);
+        im += signal[n] * std::sin(2. * std::numbers::pi * frequency * n / 48000.);
+    }
+    return float(20. * std::log10(2. * std::hypot(re, im) / signal.size()));
+}
+
+TEST_CASE(linear_passthrough)
+{
+    for (int factor: { 2, 4, 8 })
+    {
+        Oversampler ovs(factor, std::make_unique<Attenuator>());
+        ovs.ins[Attenuator::slot_gain] = 1.f;
+        auto [input, output] = render(ovs, 1000.f, 32);
+
+        float error = 0.f;
+        for (size_t n = 256; n < output.size(); n++)
+            error = std::max(error, std::abs(output[n] - input[n - ovs.latency()]));
+        CHECK(error < 1e-3f);
+    }
+}
+
+TEST_CASE(aliasing)
+{
+    // The 3rd harmonic of a 15kHz tone folds back to 3kHz at 48kHz
+    Sigmoid plain;
+    plain.ins[Sigmoid::slot_k] = 8.f;
+    Oversampler ovs(8, std::make_unique<Sigmoid>());
+    ovs.ins[Sigmoid::slot_k] = 8.f;
+
+    auto [input, direct] = render(plain, 15000.f, 375);
+    auto [unused, oversampled] = render(ovs, 15000.f, 375);
+    CHECK(magnitude(direct, 3000.f) > -30.f);
+    CHECK(magnitude(oversampled, 3000.f) < -60.f);
+    CHECK(std::abs(magnitude(direct, 15000.f) - magnitude(oversampled, 15000.f)) < 0.5f);
+}
+
+TEST_CASE(modulation)
+{
+    // An oscillator swept by an LFO within each block, oversampled or not. The sweep starts
+    // after a few silent blocks so both phases start together, then only latency parts them.
+    Group group;
+    auto& lfo = group.create<Oscillator>("lfo");
+    auto& sweep = group.create<Attenuator>("sweep");
+    auto& direct = group.create<Oscillator>("direct");
+    auto& ovs = group.create<Oversampler>("ovs", 2, std::make_unique<Oscillator>());
+    lfo.ins[Oscillator::slot_frequency] = 100.f;
+    sweep.ins[Attenuator::slot_gain] = 0.f;
+    lfo.outs[Oscillator::slot_output].connect(sweep.ins[Attenuator::slot_input]);
+    sweep.outs[Attenuator::slot_output].connect(direct.ins[Oscillator::slot_frequency]);
+    sweep.outs[Attenuator::slot_output].connect(ovs.ins[Oscillator::slot_frequency]);
+    group.prepare(64);
+
+    std::vector<float> reference, output;
+    for (int b = 0; b < 64; b++)
+    {
+        if (b == 4)
+        {
+            sweep.ins[Attenuator::slot_gain] = 200.f;
+            sweep.ins[Attenuator::slot_offset] = 400.f;
+        }
+        group.processBlock(48000.f, 64);
+        reference.insert(reference.end(), direct.outs[0].data, direct.outs[0].data + 64);
+        output.insert(output.end(), ovs.outs[0].data, ovs.outs[0].data + 64);
+    }
+
+    float error = 0.f;
+    for (size_t n = 0; n < output.size(); n++)
+        error = std::max(error, std::abs(output[n] - (n >= size_t(ovs.latency()) ? reference[n - ovs.latency()] : 0.f)));
+    CHECK(error < 0.05f);
+}
+
+TEST_ENTRY({
+    RUN_TEST(test_linear_passthrough);
+    RUN_TEST(test_aliasing);
+    RUN_TEST(test_modulation);
+})
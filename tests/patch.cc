@@ -0,0 +1,196 @@
+#include "mdlr/module.h"
+#include "mdlr/patch.h"
+#include "mdlr/modules/core.h"
+#include "mdlr/modules/enveloppe.h"
+#include "mdlr/modules/sequencer.h"
+
+#include "testing.h"
+
+#include <chrono>
+
+using namespace mdlr;
+
+static std::unique_ptr<Module> make(std::string_view type)
+{
+    if (type == "Attenuator") return std::make_unique<Attenuator>();
+    if (type == "Oscillator") return std::make_unique<Oscillator>();
+    if (type == "EnveloppeADSR") return std::make_unique<EnveloppeADSR>();
+    if (type == "Mixer8") return std::make_unique<Mixer8>();
+    return nullptr;
+}
+
+static constexpr std::string_view voice = R"(
+# acid-like voice with its own ports
+module voice Group
+module voice.osc Oscillator
+module voice.env EnveloppeADSR
+module voice.amp Attenuator
+input voice.gate
+output voice.output
+set voice.osc.frequency 220
+set voice.env.s 0.5
+connect voice.gate voice.env.gate
+connect voice.osc.output voice.amp.input
+connect voice.env.output voice.amp.gain
+connect voice.amp.output voice.output
+connect voice.output out0
+param voice.osc.accuracy int 2
+)";
+
+TEST_CASE(text_roundtrip)
+{
+    Patch patch;
+    REQUIRE(Patch::parseText(voice, patch));
+    CHECK(patch.nodes.size() == 4);
+    CHECK(patch.ports.size() == 2);
+    CHECK(patch.values.size() == 2);
+    CHECK(patch.wires.size() == 5);
+    CHECK(patch.settings.size() == 1);
+
+    Patch copy;
+    REQUIRE(Patch::parseText(patch.text(), copy));
+    CHECK(copy.text() == patch.text());
+    CHECK(copy.strings == patch.strings);
+
+    Patch invalid;
+    CHECK(!Patch::parseText("module voice\n", invalid));
+    CHECK(!Patch::parseText("set voice.osc.frequency fast\n", invalid));
+    CHECK(!Patch::parseText("param voice.osc.accuracy double 1\n", invalid));
+}
+
+TEST_CASE(binary_roundtrip)
+{
+    Patch patch;
+    REQUIRE(Patch::parseText(voice, patch));
+    patch.setParameter("voice.name", std::string("lead voice"));
+    patch.setParameter("voice.on", true);
+    patch.setParameter("voice.gain", 0.25f);
+
+    auto data = patch.binary();
+    Patch copy;
+    REQUIRE(Patch::parseBinary(data, copy));
+    CHECK(copy.text() == patch.text());
+
+    // Truncated and mistyped data is refused
+    Patch broken;
+    CHECK(!Patch::parseBinary(std::span(data).first(data.size() - 1), broken));
+    data[0] ^= 0xFF;
+    CHECK(!Patch::parseBinary(data, broken));
+}
+
+TEST_CASE(build)
+{
+    Patch patch;
+    REQUIRE(Patch::parseText(voice, patch));
+
+    Group system;
+    system.addOutput("out0");
+    REQUIRE(build(patch, system, make));
+
+    auto group = dynamic_cast<Group*>(system.findModule("voice"));
+    REQUIRE(group != nullptr);
+    CHECK(group->modules.size() == 3);
+    CHECK(system.findInput("voice.osc.frequency")->signal == 220.f);
+    CHECK(system.findInput("voice.env.s")->signal == 0.5f);
+    CHECK(system.findInput("voice.env.gate")->sources.front() == system.findInput("voice.gate"));
+    CHECK(system.findInput("voice.amp.gain")->sources.front() == system.findOutput("voice.env.output"));
+    CHECK(system.outs[0].sources.front() == system.findOutput("voice.output"));
+    CHECK(std::get<int>(ParameterValue(*system.findParameter("voice.osc.accuracy"))) == 2);
+
+    // It runs like a graph built in code
+    system.prepare(32);
+    system.findInput("voice.gate")->signal = 1.f;
+    system.processBlock(48000.f, 32);
+    CHECK(system.outs[0].data != nullptr);
+
+    Group other;
+    Patch unknown, orphan;
+    REQUIRE(Patch::parseText("module a Reverb\n", unknown));
+    CHECK(!build(unknown, other, make));
+    REQUIRE(Patch::parseText("module b.c Attenuator\n", orphan));
+    CHECK(!build(orphan, other, make));
+}
+
+TEST_CASE(capture)
+{
+    Group system;
+    system.addOutput("out0");
+    auto& acid = system.create<Group>("acid");
+    auto& clock = acid.addInput("clock");
+    auto& output = acid.addOutput("output");
+    auto& seq = acid.create<MetropolisSequencer>("seq");
+    auto& osc = acid.create<Oscillator>("osc");
+    auto& env = acid.create<EnveloppeADSR>("env");
+    auto& amp = acid.create<Attenuator>("amp");
+    clock.connect(seq.ins[MetropolisSequencer::slot_clock]);
+    seq.outs[MetropolisSequencer::slot_pitch].connect(osc.ins[Oscillator::slot_frequency]);
+    seq.outs[MetropolisSequencer::slot_gate].connect(env.ins[EnveloppeADSR::slot_gate]);
+    env.outs[EnveloppeADSR::slot_output].connect(amp.ins[Attenuator::slot_gain]);
+    osc.outs[Oscillator::slot_output].connect(amp.ins[Attenuator::slot_input]);
+    amp.outs[Attenuator::slot_output].connect(output);
+    output.connect(system.outs[0]);
+    env.ins[EnveloppeADSR::slot_d] = 0.3f;
+    *osc.findParameter("accuracy") = ParameterValue(2);
+
+    Patch patch;
+    REQUIRE(capture(system, patch));
+    CHECK(patch.nodes.size() == 5);
+    CHECK(patch.ports.size() == 2);
+    CHECK(patch.wires.size() == 7);
+
+    // Only what differs from the defaults is kept
+    CHECK(patch.values.size() == 1);
+    CHECK(patch.settings.size() == 1);
+
+    Group copy;
+    copy.addOutput("out0");
+    REQUIRE(build(patch, copy));
+    Patch again;
+    REQUIRE(capture(copy, again));
+    CHECK(again.text() == patch.text());
+    CHECK(copy.findInput("acid.env.d")->signal == 0.3f);
+    CHECK(copy.outs[0].sources.front() == copy.findOutput("acid.output"));
+}
+
+TEST_CASE(large_patch)
+{
+    // 1000 modules: 250 oscillator -> envelope -> attenuator chains into mixers
+    Patch patch;
+    patch.addPort("out0", true);
+    for (int i = 0; i < 250; i++)
+    {
+        patch.addModule(fmt::format("osc{}", i), "Oscillator");
+        patch.addModule(fmt::format("env{}", i), "EnveloppeADSR");
+        patch.addModule(fmt::format("vca{}", i), "Attenuator");
+        patch.setSignal(fmt::format("osc{}.frequency", i), 100.f + i);
+        patch.connect(fmt::format("osc{}.output", i), fmt::format("vca{}.input", i));
+        patch.connect(fmt::format("env{}.output", i), fmt::format("vca{}.gain", i));
+    }
+    for (int m = 0; m < 250; m++)
+    {
+        patch.addModule(fmt::format("mix{}", m), "Mixer8");
+        patch.connect(fmt::format("vca{}.output", m), fmt::format("mix{}.in0", m));
+        patch.connect(fmt::format("mix{}.output", m), "out0");
+    }
+
+    auto data = patch.binary();
+    const auto start = std::chrono::steady_clock::now();
+    Patch loaded;
+    Group system;
+    REQUIRE(Patch::parseBinary(data, loaded));
+    REQUIRE(build(loaded, system));
+    const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    fmt::println("1000 modules loaded in {:.2f}ms", elapsed);
+
+    CHECK(system.modules.size() == 1000);
+    CHECK(system.outs[0].sources.size() == 250);
+    CHECK(system.findInput("osc249.frequency")->signal == 349.f);
+}
+
+TEST_ENTRY({
+    RUN_TEST(test_text_roundtrip);
+    RUN_TEST(test_binary_roundtrip);
+    RUN_TEST(test_build);
+    RUN_TEST(test_capture);
+    RUN_TEST(test_large_patch);
+})
@@ -0,0 +1,123 @@
+#include "mdlr/module.h"
+#include "mdlr/modules/core.h"
+#include "mdlr/modules/poly.h"
+
+#include "testing.h"
+
+using namespace mdlr;
+
+TEST_CASE(allocate_idle_first)
+{
+    VoiceAllocator allocator;
+    allocator.resize(3);
+    CHECK(allocator.noteOn(60, 1.f) == 0);
+    CHECK(allocator.noteOn(62, 1.f) == 1);
+    CHECK(allocator.noteOff(60) == 0);
+    CHECK(allocator.noteOff(60) == -1);
+
+    // A released voice is only reused once no idle voice is left
+    CHECK(allocator.noteOn(64, 1.f) == 2);
+    CHECK(allocator.noteOn(65, 1.f) == 0);
+}
+
+TEST_CASE(steal_policies)
+{
+    VoiceAllocator allocator;
+    allocator.resize(2);
+    allocator.noteOn(60, 1.f);
+    allocator.noteOn(62, 1.f);
+    allocator.level = { 0.9f, 0.1f };
+    CHECK(allocator.choose(64) == 0);
+
+    allocator.policy = VoiceAllocator::Policy::quietest;
+    CHECK(allocator.choose(64) == 1);
+
+    allocator.policy = VoiceAllocator::Policy::samenote;
+    CHECK(allocator.choose(62) == 1);
+    CHECK(allocator.choose(64) == 0);
+}
+
+TEST_CASE(note_off_releases_every_voice)
+{
+    // Without samenote a repeated note starts a second voice, one note off releases both
+    VoiceAllocator allocator;
+    allocator.resize(3);
+    CHECK(allocator.noteOn(60, 1.f) == 0);
+    CHECK(allocator.noteOn(60, 1.f) == 1);
+    CHECK(allocator.noteOn(62, 1.f) == 2);
+    CHECK(allocator.noteOff(60) == 0);
+    CHECK(allocator.gate[0] == 0.f);
+    CHECK(allocator.gate[1] == 0.f);
+    CHECK(allocator.gate[2] == 1.f);
+    CHECK(allocator.find(60) == -1);
+}
+
+TEST_CASE(idle_voices_are_skipped)
+{
+    PolyGroup poly(4, [](Group& voice)
+    {
+        auto& gate = voice.addInput("gate");
+        auto& output = voice.addOutput("output");
+        auto& osc = voice.create<Oscillator>("osc");
+        auto& vca = voice.create<Attenuator>("vca");
+        osc.outs[Oscillator::slot_output].connect(vca.ins[Attenuator::slot_input]);
+        gate.connect(vca.ins[Attenuator::slot_gain]);
+        vca.outs[Attenuator::slot_output].connect(output);
+    });
+    poly.prepare(64);
+
+    auto send = [&](uint8_t status, uint8_t key)
+    {
+        poly.queue.events.push(MidiEvent { .time = MidiEventQueue::now(), .bytes = { status, key, 100 } });
+    };
+
+    poly.processBlock(48000.f, 64);
+    CHECK(poly.outs[0].buffer[63] == 0.f);
+
+    send(0x90, 60);
+    send(0x90, 64);
+    poly.processBlock(48000.f, 64);
+    CHECK(poly.allocator.active[0] == 1);
+    CHECK(poly.allocator.active[1] == 1);
+    CHECK(poly.allocator.active[2] == 0);
+    CHECK(poly.voices[0].gate->data[63] == 1.f);
+    CHECK(poly.voices[0].group->plan.steps.size() == 2);
+    CHECK(poly.voices[2].group->plan.steps.empty());
+
+    // The attenuator glides its gain down, the voice idles once it is silent
+    send(0x80, 60);
+    for (int b = 0; b < 64; b++)
+        poly.processBlock(48000.f, 64);
+    CHECK(poly.allocator.active[0] == 0);
+    CHECK(poly.allocator.active[1] == 1);
+}
+
+TEST_CASE(voices_from_patch)
+{
+    Patch voice;
+    voice.addModule("osc", "Oscillator");
+    voice.addModule("vca", "Attenuator");
+    voice.addPort("gate", false);
+    voice.addPort("output", true);
+    voice.connect("osc.output", "vca.input");
+    voice.connect("gate", "vca.gain");
+    voice.connect("vca.output", "output");
+
+    PolyGroup poly(8, voice);
+    CHECK(poly.voices.size() == 8);
+    for (const auto& v: poly.voices)
+    {
+        CHECK(v.gate != nullptr);
+        CHECK(v.output != nullptr);
+        CHECK(v.pitch == nullptr);
+        CHECK(v.group->modules.size() == 2);
+    }
+}
+
+TEST_ENTRY({
+    RUN_TEST(test_allocate_idle_first);
+    RUN_TEST(test_steal_policies);
+    RUN_TEST(test_note_off_releases_every_voice);
+    RUN_TEST(test_idle_voices_are_skipped);
+    RUN_TEST(test_voices_from_patch);
+})
@@ -0,0 +1,61 @@
+#include "mdlr/module.h"
+#include "mdlr/registry.h"
+#include "mdlr/modules/core.h"
+#include "mdlr/modules/enveloppe.h"
+#include "mdlr/modules/sequencer.h"
+
+#include "testing.h"
+
+#include <algorithm>
+
+using namespace mdlr;
+
+TEST_CASE(self_registration)
+{
+    auto& registry = Registry::instance();
+    auto types = registry.types();
+    for (auto type: { "Group", "Attenuator", "Oscillator", "Mixer8", "EnveloppeADSR", "MetropolisSequencer" })
+        CHECK(std::find(types.begin(), types.end(), type) != types.end());
+    CHECK(std::is_sorted(types.begin(), types.end()));
+
+    auto module = registry.create("EnveloppeADSR");
+    REQUIRE(module != nullptr);
+    CHECK(dynamic_cast<EnveloppeADSR*>(module.get()) != nullptr);
+    CHECK(registry.create("Reverb") == nullptr);
+    CHECK(registry.find("Reverb") == nullptr);
+}
+
+TEST_CASE(metadata)
+{
+    auto& registry = Registry::instance();
+    auto env = registry.find("EnveloppeADSR");
+    REQUIRE(env != nullptr);
+    REQUIRE(env->ins.size() == 5);
+    auto s = env->input("s");
+    REQUIRE(s != nullptr);
+    CHECK(s->index == EnveloppeADSR::slot_s);
+    CHECK(s->rate == Rate::control);
+    CHECK(s->min == 0.f);
+    CHECK(s->max == 1.f);
+    CHECK(env->input("gate")->rate == Rate::event);
+    CHECK(env->output("output")->index == EnveloppeADSR::slot_output);
+    CHECK(env->input("output") == nullptr);
+
+    auto osc = registry.find("Oscillator");
+    REQUIRE(osc != nullptr);
+    CHECK(osc->input("frequency")->value == 120.f);
+    auto accuracy = osc->parameter("accuracy");
+    REQUIRE(accuracy != nullptr);
+    CHECK(std::holds_alternative<int>(accuracy->value));
+
+    // Instances resolve to their type
+    Attenuator amp;
+    Group group;
+    CHECK(registry.find(amp) == registry.find("Attenuator"));
+    CHECK(registry.find(group)->type == "Group");
+}
+
+TEST_ENTRY({
+    RUN_TEST(test_self_registration);
+    RUN_TEST(test_metadata);
+})
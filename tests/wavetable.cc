@@ -0,0 +1,66 @@
+#include "mdlr/module.h"
+#include "mdlr/modules/wavetable.h"
+
+#include "testing.h"
+
+#include <cmath>
+#include <numbers>
+
+using namespace mdlr;
+
+// Sine amplitude of one harmonic of a table cycle
+static float harmonic(const float* cycle, int k)
+{
+    double sum = 0.;
+    for (int i = 0; i < Wavetable::Size; i++)
+        sum += cycle[i] * std::sin(2. * std::numbers::pi * k * i / Wavetable::Size);
+    return float(2. * sum / Wavetable::Size);
+}
+
+TEST_CASE(mip_levels)
+{
+    CHECK(Wavetable::level(0.f) == 0);
+    CHECK(Wavetable::level(1.f / Wavetable::Size) == 0);
+    CHECK(Wavetable::level(440.f / 48000.f) == 5);
+    CHECK(Wavetable::level(0.5f) == Wavetable::Levels - 1);
+}
+
+TEST_CASE(band_limited)
+{
+    auto saw = WavetableBank::instance().find("saw");
+    REQUIRE(saw != nullptr);
+
+    // Level 5 keeps 32 harmonics
+    const float* cycle = saw->cycle(0, 5);
+    CHECK(std::abs(harmonic(cycle, 10) + 2.f / (std::numbers::pi_v<float> * 10)) < 1e-4f);
+    CHECK(std::abs(harmonic(cycle, 32)) > 1e-3f);
+    CHECK(std::abs(harmonic(cycle, 33)) < 1e-4f);
+    CHECK(cycle[Wavetable::Size] == cycle[0]);
+}
+
+TEST_CASE(oscillator)
+{
+    WavetableOscillator osc;
+    osc.prepare(256);
+    osc.ins[WavetableOscillator::slot_frequency].hold();
+    osc.ins[WavetableOscillator::slot_position].hold();
+    osc.setParameter(*osc.tableparam, std::string("square"));
+    CHECK(osc.tableparam->string() == "square");
+    CHECK(osc.table == WavetableBank::instance().find("square"));
+
+    float peak = 0.f;
+    for (int b = 0; b < 8; b++)
+    {
+        osc.processBlock(48000.f, 256);
+        for (auto s: osc.outs[0].buffer)
+            peak = std::max(peak, std::abs(s));
+    }
+    CHECK(peak > 0.9f);
+    CHECK(peak < 1.2f);
+}
+
+TEST_ENTRY({
+    RUN_TEST(test_mip_levels);
+    RUN_TEST(test_band_limited);
+    RUN_TEST(test_oscillator);
+})